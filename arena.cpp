@@ -0,0 +1,74 @@
+#include "arena.hpp"
+#include <cstdint>
+#include <cstdlib>
+
+Arena::~Arena()
+{
+    while (_blocks)
+    {
+        Block* next = _blocks->next;
+        std::free(_blocks);
+        _blocks = next;
+    }
+}
+
+Arena::Arena(Arena&& other) noexcept
+{
+    *this = std::move(other);
+}
+
+Arena& Arena::operator=(Arena&& other) noexcept
+{
+    std::swap(_blocks, other._blocks);
+    std::swap(_next, other._next);
+    std::swap(_end, other._end);
+    std::swap(_bytesUsed, other._bytesUsed);
+    std::swap(_blockCount, other._blockCount);
+    return *this;
+}
+
+void* Arena::allocate(size_t size, size_t alignment)
+{
+    uintptr_t next = reinterpret_cast<uintptr_t>(_next);
+    uintptr_t aligned = (next + alignment - 1) & ~(uintptr_t(alignment) - 1);
+
+    if (!_next || aligned + size > reinterpret_cast<uintptr_t>(_end))
+    {
+        // Oversized requests get a block of their own, so that the current
+        // block can keep being used for small objects
+        if (size > kBlockSize / 4)
+        {
+            _bytesUsed += size;
+            return allocateBlock(size);
+        }
+
+        _next = static_cast<char*>(allocateBlock(kBlockSize));
+        _end = _next + kBlockSize;
+
+        next = reinterpret_cast<uintptr_t>(_next);
+        aligned = (next + alignment - 1) & ~(uintptr_t(alignment) - 1);
+    }
+
+    _next = reinterpret_cast<char*>(aligned + size);
+    _bytesUsed += size;
+
+    return reinterpret_cast<void*>(aligned);
+}
+
+void* Arena::allocateBlock(size_t size)
+{
+    // The block header is padded so that the data area is maximally aligned
+    size_t headerSize = (sizeof(Block) + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1);
+
+    Block* block = static_cast<Block*>(std::malloc(headerSize + size));
+    if (!block)
+    {
+        throw std::bad_alloc();
+    }
+
+    block->next = _blocks;
+    _blocks = block;
+    ++_blockCount;
+
+    return reinterpret_cast<char*>(block) + headerSize;
+}
@@ -0,0 +1,103 @@
+#pragma once
+#include <cstddef>
+#include <initializer_list>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// Non-owning view of a contiguous array (usually one allocated from an Arena)
+template <typename T>
+class Span
+{
+public:
+    Span() = default;
+
+    Span(T* data, size_t size)
+    : _data(data), _size(size)
+    {}
+
+    T* begin() const { return _data; }
+    T* end() const { return _data + _size; }
+
+    T& operator[](size_t i) const { return _data[i]; }
+
+    T* data() const { return _data; }
+    size_t size() const { return _size; }
+    bool empty() const { return _size == 0; }
+
+private:
+    T* _data = nullptr;
+    size_t _size = 0;
+};
+
+// Bump-pointer allocator. Objects are carved out of large blocks and are never
+// freed individually: everything is released at once when the arena is destroyed.
+// Destructors are not run, so only trivially-destructible types may be allocated.
+class Arena
+{
+public:
+    Arena() = default;
+    ~Arena();
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    // Objects already allocated stay where they are, owned by the new arena
+    Arena(Arena&& other) noexcept;
+    Arena& operator=(Arena&& other) noexcept;
+
+    void* allocate(size_t size, size_t alignment);
+
+    template <typename T, typename... Args>
+    T* make(Args&&... args)
+    {
+        static_assert(std::is_trivially_destructible<T>::value, "arena objects are never destroyed");
+        return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+
+    // Uninitialized array of the given size
+    template <typename T>
+    Span<T> makeArray(size_t size)
+    {
+        static_assert(std::is_trivially_destructible<T>::value, "arena objects are never destroyed");
+        if (size == 0) return Span<T>();
+
+        T* data = static_cast<T*>(allocate(sizeof(T) * size, alignof(T)));
+        return Span<T>(data, size);
+    }
+
+    template <typename T>
+    Span<T> makeArray(std::initializer_list<T> values)
+    {
+        Span<T> result = makeArray<T>(values.size());
+
+        size_t i = 0;
+        for (const T& value : values)
+        {
+            result[i++] = value;
+        }
+
+        return result;
+    }
+
+    // Total bytes handed out, and number of blocks requested from the system
+    size_t bytesUsed() const { return _bytesUsed; }
+    size_t blockCount() const { return _blockCount; }
+
+private:
+    struct Block
+    {
+        Block* next;
+    };
+
+    static constexpr size_t kBlockSize = 64 * 1024;
+
+    void* allocateBlock(size_t size);
+
+    Block* _blocks = nullptr;
+    char* _next = nullptr;
+    char* _end = nullptr;
+
+    size_t _bytesUsed = 0;
+    size_t _blockCount = 0;
+};
@@ -0,0 +1,26 @@
+#include "ast.hpp"
+
+namespace ast
+{
+
+Symbol Context::intern(std::string_view name)
+{
+    auto i = _symbols.find(name);
+    if (i != _symbols.end())
+    {
+        return Symbol(i->second);
+    }
+
+    // Copy the name, so that it lives exactly as long as the nodes
+    Span<char> chars = _arena.makeArray<char>(name.size());
+    std::copy(name.begin(), name.end(), chars.begin());
+
+    Symbol::Entry* entry = _arena.make<Symbol::Entry>();
+    entry->name = std::string_view(chars.data(), chars.size());
+    entry->id = _symbols.size();
+    _symbols.emplace(entry->name, entry);
+
+    return Symbol(entry);
+}
+
+} // namespace ast
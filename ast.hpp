@@ -1,26 +1,96 @@
 #pragma once
+#include "arena.hpp"
+#include "diagnostics.hpp"
 #include "visitor.hpp"
-#include <memory>
-#include <string>
-#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
 
 namespace ast
 {
 
 class Expr;
 
+// Identifier interned by a Context: the same name is always the same symbol,
+// so symbols compare by identity, and their dense ids can index tables
+class Symbol
+{
+public:
+    struct Entry
+    {
+        std::string_view name;
+        uint32_t id;
+    };
+
+    Symbol() = default;
+
+    explicit Symbol(const Entry* entry)
+    : _entry(entry)
+    {}
+
+    std::string_view str() const { return _entry->name; }
+    uint32_t id() const { return _entry->id; }
+
+    bool operator==(Symbol other) const { return _entry == other._entry; }
+    bool operator!=(Symbol other) const { return _entry != other._entry; }
+
+private:
+    const Entry* _entry = nullptr;
+};
+
+// Top-level declaration of a module: let name = value
+struct Declaration
+{
+    Symbol name;
+    Expr* value;
+};
+
 // Owner for all AST nodes
+//
+// Nodes, their lists of children and parameters, and the names of symbols are
+// all allocated contiguously from an arena, and freed together with it.
 class Context
 {
 public:
-    void insert(Expr* expr) { _nodes.emplace_back(expr); }
+    Symbol intern(std::string_view name);
+
+    // Number of distinct symbols interned so far (one more than the highest id)
+    size_t symbolCount() const { return _symbols.size(); }
 
+    // Storage for a single node
+    template <typename T>
+    void* allocate()
+    {
+        static_assert(std::is_trivially_destructible<T>::value, "nodes are never destroyed");
+        return _arena.allocate(sizeof(T), alignof(T));
+    }
+
+    // Copies a list of children or parameters
+    template <typename T>
+    Span<T> makeList(const T* items, size_t count)
+    {
+        Span<T> result = _arena.makeArray<T>(count);
+        std::copy(items, items + count, result.begin());
+        return result;
+    }
+
+    // A program is a single expression, a module a list of declarations
     Expr* root() { return _root; }
     void setRoot(Expr* root) { _root = root; }
 
+    Span<Declaration> declarations() { return _declarations; }
+    void setDeclarations(Span<Declaration> declarations) { _declarations = declarations; }
+
+    const Arena& arena() const { return _arena; }
+
 private:
+    Arena _arena;
     Expr* _root = nullptr;
-    std::vector<std::unique_ptr<Expr>> _nodes;
+    Span<Declaration> _declarations;
+
+    std::unordered_map<std::string_view, const Symbol::Entry*> _symbols;
 };
 
 // Generic base class
@@ -28,25 +98,29 @@ class Expr
 {
 public:
     virtual void accept(Visitor* visitor) = 0;
+
+    // Where the expression appears in the source (set by the Parser)
+    SourceRange range;
 };
 
 // Variable reference: x
 class Var : public Expr
 {
 public:
-    static Var* create(Context& context, const std::string& name)
+    static Var* create(Context& context, Symbol name)
     {
-        Var* result = new Var(name);
-        context.insert(result);
-        return result;
+        return new (context.allocate<Var>()) Var(name);
     }
 
     virtual void accept(Visitor* visitor) override { visitor->visit(this); }
 
-    std::string name;
+    Symbol name;
+
+    // Position of the referenced binding in the environment (see Resolver)
+    int slot = -1;
 
 private:
-    Var(const std::string& name)
+    Var(Symbol name)
     : name(name)
     {}
 };
@@ -55,20 +129,18 @@ private:
 class Call : public Expr
 {
 public:
-    static Call* create(Context& context, Expr* function, const std::vector<Expr*>& arguments)
+    static Call* create(Context& context, Expr* function, Span<Expr*> arguments)
     {
-        Call* result = new Call(function, arguments);
-        context.insert(result);
-        return result;
+        return new (context.allocate<Call>()) Call(function, arguments);
     }
 
     virtual void accept(Visitor* visitor) override { visitor->visit(this); }
 
     Expr* function;
-    std::vector<Expr*> arguments;
+    Span<Expr*> arguments;
 
 private:
-    Call(Expr* function, const std::vector<Expr*>& arguments)
+    Call(Expr* function, Span<Expr*> arguments)
     : function(function), arguments(arguments)
     {}
 };
@@ -77,20 +149,18 @@ private:
 class Fun : public Expr
 {
 public:
-    static Fun* create(Context& context, const std::vector<std::string>& parameters, Expr* body)
+    static Fun* create(Context& context, Span<Symbol> parameters, Expr* body)
     {
-        Fun* result = new Fun(parameters, body);
-        context.insert(result);
-        return result;
+        return new (context.allocate<Fun>()) Fun(parameters, body);
     }
 
     virtual void accept(Visitor* visitor) override { visitor->visit(this); }
 
-    std::vector<std::string> parameters;
+    Span<Symbol> parameters;
     Expr* body;
 
 private:
-    Fun(const std::vector<std::string>& parameters, Expr* body)
+    Fun(Span<Symbol> parameters, Expr* body)
     : parameters(parameters), body(body)
     {}
 };
@@ -99,21 +169,24 @@ private:
 struct Let : public Expr
 {
 public:
-    static Let* create(Context& context, const std::string& name, Expr* value, Expr* body)
+    static Let* create(Context& context, Symbol name, Expr* value, Expr* body)
     {
-        Let* result = new Let(name, value, body);
-        context.insert(result);
-        return result;
+        return new (context.allocate<Let>()) Let(name, value, body);
     }
 
     virtual void accept(Visitor* visitor) override { visitor->visit(this); }
 
-    std::string name;
+    Symbol name;
     Expr* value;
     Expr* body;
 
+    // Identifies the value together with everything it refers to, or 0 if its
+    // type may depend on enclosing function parameters (see Fingerprinter)
+    uint64_t fingerprint = 0;
+    uint32_t valueSize = 0; // number of nodes in the value
+
 private:
-    Let(const std::string& name, Expr* value, Expr* body)
+    Let(Symbol name, Expr* value, Expr* body)
     : name(name), value(value), body(body)
     {}
 };
@@ -0,0 +1,185 @@
+#pragma once
+#include "parser.hpp"
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// Shared helpers for the benchmark executables
+
+namespace bench
+{
+
+class Timer
+{
+public:
+    Timer()
+    : _start(std::chrono::steady_clock::now())
+    {}
+
+    double seconds() const
+    {
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - _start;
+        return elapsed.count();
+    }
+
+private:
+    std::chrono::steady_clock::time_point _start;
+};
+
+// A parsed program, kept with the text which its AST refers to
+struct ParsedProgram
+{
+    std::string text;
+    ast::Context ast;
+};
+
+inline std::unique_ptr<ParsedProgram> parse(std::string text)
+{
+    auto parsed = std::make_unique<ParsedProgram>();
+    parsed->text = std::move(text);
+
+    Parser parser(parsed->text);
+    parsed->ast = parser.parse();
+
+    return parsed;
+}
+
+// Peak resident set size of this process, in kilobytes
+inline long peakRssKb()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+// Hardware cache-miss counter for the calling thread. Reports -1 when
+// performance counters are unavailable (e.g. inside most containers).
+class CacheMisses
+{
+public:
+    CacheMisses()
+    {
+        struct perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_CACHE_MISSES;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+
+        _fd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+
+    ~CacheMisses()
+    {
+        if (_fd != -1) close(_fd);
+    }
+
+    CacheMisses(const CacheMisses&) = delete;
+    CacheMisses& operator=(const CacheMisses&) = delete;
+
+    void start()
+    {
+        if (_fd == -1) return;
+        ioctl(_fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(_fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+
+    long long stop()
+    {
+        if (_fd == -1) return -1;
+        ioctl(_fd, PERF_EVENT_IOC_DISABLE, 0);
+
+        long long count;
+        if (read(_fd, &count, sizeof(count)) != sizeof(count)) return -1;
+        return count;
+    }
+
+private:
+    int _fd;
+};
+
+// Runs parameterised microbenchmarks and reports them as JSON
+class Suite
+{
+public:
+    // Further measurements reported with a result, by name
+    using Counters = std::vector<std::pair<std::string, double>>;
+
+    explicit Suite(double minSeconds = 0.05)
+    : _minSeconds(minSeconds)
+    {}
+
+    // setup() is not timed, and produces the input for a single call of
+    // op(input). The pair is repeated until enough time has been measured.
+    template <typename Setup, typename Op>
+    void run(const std::string& name, long param, Setup setup, Op op)
+    {
+        long iterations = 0;
+        double seconds = 0;
+
+        while (seconds < _minSeconds || iterations < 10)
+        {
+            auto input = setup();
+
+            Timer timer;
+            op(input);
+            seconds += timer.seconds();
+
+            ++iterations;
+        }
+
+        add(name, param, iterations, seconds);
+    }
+
+    // Reports a benchmark which did its own timing
+    void add(const std::string& name, long param, long iterations, double seconds,
+             Counters counters = Counters())
+    {
+        _results.push_back({name, param, iterations, seconds * 1e9 / iterations, std::move(counters)});
+    }
+
+    void writeJson(std::ostream& out) const
+    {
+        out << "{\n  \"benchmarks\": [\n";
+        for (size_t i = 0; i < _results.size(); ++i)
+        {
+            const Result& result = _results[i];
+            out << "    {\"name\": \"" << result.name << "\", "
+                << "\"param\": " << result.param << ", "
+                << "\"iterations\": " << result.iterations << ", "
+                << "\"ns_per_op\": " << result.nsPerOp;
+            for (const auto& counter : result.counters)
+            {
+                out << ", \"" << counter.first << "\": " << counter.second;
+            }
+            out << "}" << (i + 1 < _results.size() ? ",\n" : "\n");
+        }
+        out << "  ]\n}\n";
+    }
+
+private:
+    struct Result
+    {
+        std::string name;
+        long param;
+        long iterations;
+        double nsPerOp;
+        Counters counters;
+    };
+
+    double _minSeconds;
+    std::vector<Result> _results;
+};
+
+} // namespace bench
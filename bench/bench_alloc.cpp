@@ -0,0 +1,68 @@
+#include "bench.hpp"
+#include "parser.hpp"
+#include "semantic.hpp"
+#include <cstdlib>
+#include <iostream>
+#include <new>
+
+// Checks many small programs in a single process, each with a fresh analyzer,
+// and reports heap allocations per program and the peak RSS of the process
+
+static size_t s_allocations = 0;
+
+void* operator new(size_t size)
+{
+    ++s_allocations;
+    if (void* p = std::malloc(size))
+    {
+        return p;
+    }
+
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+static const char* s_programs[] = {
+    "let f = fun x, y -> x in f(zero, one)",
+    "let f = fun x -> fun y -> y in f(one)",
+    "fun x -> let y = fun z -> x(z) in y",
+    "fun f -> eq(f(one), one)",
+    "let compose = fun f, g -> fun x -> f(g(x)) in compose(succ, succ)(one)",
+    "let twice = fun f -> fun x -> f(f(x)) in twice(twice(succ))(zero)",
+};
+
+int main(int argc, char** argv)
+{
+    int iterations = argc > 1 ? std::atoi(argv[1]) : 100000;
+
+    size_t programs = 0;
+    size_t before = s_allocations;
+    bench::Timer timer;
+
+    for (int i = 0; i < iterations; ++i)
+    {
+        for (const char* program : s_programs)
+        {
+            Parser parser(program);
+            ast::Context ast = parser.parse();
+
+            SemanticAnalyzer semant;
+            semant.infer(ast.root());
+
+            ++programs;
+        }
+    }
+
+    double seconds = timer.seconds();
+    size_t allocations = s_allocations - before;
+
+    std::cout << "programs: " << programs << "\n";
+    std::cout << "allocations: " << allocations << "\n";
+    std::cout << "allocations per program: " << double(allocations) / programs << "\n";
+    std::cout << "programs per second: " << programs / seconds << "\n";
+    std::cout << "peak rss (KB): " << bench::peakRssKb() << "\n";
+
+    return 0;
+}
@@ -0,0 +1,71 @@
+#include "bench.hpp"
+#include "parser.hpp"
+#include "semantic.hpp"
+#include "thread_pool.hpp"
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Wall-clock time to check a batch of independent programs, as in `hmc FILE...`,
+// for increasing numbers of worker threads
+
+static std::string generate(int seed, int size)
+{
+    std::string program;
+    for (int i = 0; i < size; ++i)
+    {
+        std::string name = "f" + std::to_string(i);
+        program += "let " + name + " = fun x, y -> add(x, succ(y)) in\n";
+        program += "let g" + std::to_string(i) + " = " + name + "(one, zero) in\n";
+    }
+
+    program += (seed % 2) ? "f0" : "zero";
+    return program;
+}
+
+static double run(const std::vector<std::string>& programs, unsigned threads)
+{
+    bench::Timer timer;
+    {
+        ThreadPool pool(threads);
+        for (auto& program : programs)
+        {
+            pool.submit([&program] {
+                Parser parser(program);
+                ast::Context ast = parser.parse();
+
+                SemanticAnalyzer semant;
+                semant.infer(ast.root());
+            });
+        }
+    }
+
+    return timer.seconds();
+}
+
+int main(int argc, char** argv)
+{
+    int count = argc > 1 ? std::atoi(argv[1]) : 2000;
+    int size = argc > 2 ? std::atoi(argv[2]) : 200;
+
+    std::vector<std::string> programs;
+    for (int i = 0; i < count; ++i)
+    {
+        programs.push_back(generate(i, size));
+    }
+
+    unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    double baseline = run(programs, 1);
+    std::cout << "threads: 1, seconds: " << baseline << ", speedup: 1\n";
+
+    for (unsigned threads = 2; threads <= cores; threads *= 2)
+    {
+        double seconds = run(programs, threads);
+        std::cout << "threads: " << threads << ", seconds: " << seconds
+                  << ", speedup: " << baseline / seconds << "\n";
+    }
+
+    return 0;
+}
@@ -0,0 +1,91 @@
+#include "bench.hpp"
+#include "corpus.hpp"
+#include "parser.hpp"
+#include "semantic.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+// End-to-end throughput (parsing and checking, as in hmc) over generated
+// programs of increasing size. Every size class has about the same number of
+// definitions in all, so nodes/s should stay flat unless something is not
+// linear in the size of a program.
+//
+//   bench_corpus [LARGEST] [DEPTH] [ARITY] [FAN_OUT] [POLYMORPHISM] [ILL_TYPED] [SEED]
+//
+// Each program is generated just before it is checked, and only parsing and
+// checking are timed. Prints JSON, with one result per size class, timed per
+// program.
+//
+// Peak memory is the process's peak RSS once the class has run. Classes run
+// from the smallest, and each program is freed before the next, so this is
+// the peak for the largest program yet. The AST and type arena bytes of the
+// largest program in the class are reported too, since they are exact and
+// exclude the generator and the allocator's slack.
+
+int main(int argc, char** argv)
+{
+    int largest = argc > 1 ? std::atoi(argv[1]) : 100000;
+
+    bench::ProgramShape shape;
+    shape.depth = argc > 2 ? std::atoi(argv[2]) : shape.depth;
+    shape.arity = argc > 3 ? std::atoi(argv[3]) : shape.arity;
+    shape.fanOut = argc > 4 ? std::atoi(argv[4]) : shape.fanOut;
+    shape.polymorphism = argc > 5 ? std::atoi(argv[5]) : shape.polymorphism;
+    shape.illTyped = argc > 6 ? std::atoi(argv[6]) : shape.illTyped;
+    uint64_t seed = argc > 7 ? std::atoll(argv[7]) : 1;
+
+    bench::Suite suite;
+
+    for (int size = 10; size <= largest; size *= 10)
+    {
+        shape.definitions = size;
+        bench::ProgramGenerator generator(shape, seed);
+
+        int programs = std::max(1, largest / size);
+        size_t bytes = 0;
+        size_t nodes = 0;
+        size_t errors = 0;
+        size_t astBytes = 0;
+        size_t typeBytes = 0;
+        double seconds = 0;
+        for (int i = 0; i < programs; ++i)
+        {
+            bench::GeneratedProgram program = generator.generate();
+            bytes += program.text.size();
+            nodes += program.nodes;
+
+            bench::Timer timer;
+            ast::Context ast;
+            SemanticAnalyzer semant;
+            try
+            {
+                Parser parser(program.text);
+                ast = parser.parse();
+                semant.infer(ast.root());
+            }
+            catch (const std::runtime_error&)
+            {
+                ++errors;
+            }
+            seconds += timer.seconds();
+
+            astBytes = std::max(astBytes, ast.arena().bytesUsed());
+            typeBytes = std::max(typeBytes, semant.types().arena().bytesUsed());
+        }
+
+        suite.add("corpus", size, programs, seconds,
+            {{"errors", errors},
+             {"nodes_per_s", nodes / seconds},
+             {"mb_per_s", bytes / seconds / (1 << 20)},
+             {"peak_rss_kb", bench::peakRssKb()},
+             {"ast_kb", astBytes / 1024},
+             {"types_kb", typeBytes / 1024}});
+    }
+
+    suite.writeJson(std::cout);
+
+    return 0;
+}
@@ -0,0 +1,114 @@
+#include "bench.hpp"
+#include "diagnostics.hpp"
+#include "parser.hpp"
+#include "semantic.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Programs checked per second as more of them are ill-typed, when each error
+// is thrown (and only the first found) and when errors are collected as
+// diagnostics and checking goes on
+//
+//   bench_errors [COUNT] [SIZE] [REPETITIONS]
+
+// Every tenth call of an ill-typed program passes a boolean where an integer
+// is expected
+static std::string generate(int size, bool illTyped)
+{
+    std::string program;
+    for (int i = 0; i < size; ++i)
+    {
+        std::string name = "f" + std::to_string(i);
+        std::string argument = illTyped && i % 10 == 0 ? "true" : "one";
+        program += "let " + name + " = fun x, y -> add(x, succ(y)) in\n";
+        program += "let g" + std::to_string(i) + " = " + name + "(" + argument + ", zero) in\n";
+    }
+
+    program += "zero";
+    return program;
+}
+
+// Seconds to check every program, and the number of errors found
+static double runThrowing(const std::vector<std::string>& programs, size_t& errors)
+{
+    errors = 0;
+
+    bench::Timer timer;
+    for (auto& program : programs)
+    {
+        try
+        {
+            Parser parser(program);
+            ast::Context ast = parser.parse();
+
+            SemanticAnalyzer semant;
+            semant.infer(ast.root());
+        }
+        catch (const std::runtime_error&)
+        {
+            ++errors;
+        }
+    }
+
+    return timer.seconds();
+}
+
+static double runDiagnostics(const std::vector<std::string>& programs, size_t& errors)
+{
+    errors = 0;
+
+    bench::Timer timer;
+    for (auto& program : programs)
+    {
+        Diagnostics diagnostics;
+        Parser parser(program);
+        ast::Context ast = parser.parse(diagnostics);
+
+        if (ast.root())
+        {
+            SemanticAnalyzer semant;
+            semant.infer(ast.root(), diagnostics);
+        }
+
+        errors += diagnostics.size();
+    }
+
+    return timer.seconds();
+}
+
+int main(int argc, char** argv)
+{
+    int count = argc > 1 ? std::atoi(argv[1]) : 500;
+    int size = argc > 2 ? std::atoi(argv[2]) : 100;
+    int repetitions = argc > 3 ? std::atoi(argv[3]) : 5;
+
+    for (int percent : {0, 10, 50, 100})
+    {
+        std::vector<std::string> programs;
+        for (int i = 0; i < count; ++i)
+        {
+            programs.push_back(generate(size, i * 100 < percent * count));
+        }
+
+        // Alternate the two, keeping the best of each
+        double throwing = 1e300;
+        double collecting = 1e300;
+        size_t thrown = 0;
+        size_t reported = 0;
+        for (int i = 0; i < repetitions; ++i)
+        {
+            throwing = std::min(throwing, runThrowing(programs, thrown));
+            collecting = std::min(collecting, runDiagnostics(programs, reported));
+        }
+
+        std::cout << "ill-typed: " << percent << "%, "
+                  << "throwing: " << count / throwing << " programs/s (" << thrown << " errors), "
+                  << "diagnostics: " << count / collecting << " programs/s (" << reported << " errors)\n";
+    }
+
+    return 0;
+}
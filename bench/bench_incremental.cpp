@@ -0,0 +1,65 @@
+#include "bench.hpp"
+#include "semantic.hpp"
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+
+// Edit-to-result latency: re-checking a program of n bindings after a single
+// binding has been edited, from scratch and with a TypeCache holding the
+// previous version. Parsing is measured separately, since it is repeated in
+// full either way. Prints JSON:
+//
+//   bench_incremental [MIN_SECONDS_PER_CASE] > results.json
+
+// n function bindings, each used by one other binding. The edited binding's
+// parameter is renamed, which changes it (and its user) but not its type.
+static std::string generate(long n, long edited, const std::string& param)
+{
+    std::string program;
+    for (long i = 0; i < n; ++i)
+    {
+        std::string name = "f" + std::to_string(i);
+        std::string y = (i == edited) ? param : "y";
+        program += "let " + name + " = fun x, " + y + " ->\n";
+        program += "    let a = add(x, succ(" + y + ")) in\n";
+        program += "    let b = fun z -> add(a, z) in\n";
+        program += "    nonzero(b(b(x))) in\n";
+        program += "let g" + std::to_string(i) + " = " + name + "(one, zero) in\n";
+    }
+
+    program += "g0";
+    return program;
+}
+
+static void check(ast::Context& ast, typ::TypeCache* cache)
+{
+    SemanticAnalyzer semant;
+    semant.setCache(cache);
+    semant.infer(ast.root());
+}
+
+int main(int argc, char** argv)
+{
+    bench::Suite suite(argc > 1 ? std::atof(argv[1]) : 0.05);
+
+    for (long n : {100, 1000, 10000})
+    {
+        // Every iteration makes a different edit, so that it cannot be cached
+        long edits = 0;
+        auto edit = [&] { return generate(n, n / 2, "y" + std::to_string(edits++)); };
+
+        suite.run("parse", n, edit, [](std::string& program) { bench::parse(program); });
+
+        auto editParsed = [&] { return bench::parse(edit()); };
+        suite.run("check/full", n, editParsed, [](std::unique_ptr<bench::ParsedProgram>& f) { check(f->ast, nullptr); });
+
+        typ::TypeCache cache;
+        check(bench::parse(generate(n, -1, ""))->ast, &cache);
+        suite.run("check/incremental", n, editParsed, [&](std::unique_ptr<bench::ParsedProgram>& f) { check(f->ast, &cache); });
+    }
+
+    suite.writeJson(std::cout);
+
+    return 0;
+}
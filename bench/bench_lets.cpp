@@ -0,0 +1,65 @@
+#include "bench.hpp"
+#include "semantic.hpp"
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+
+// Checking long chains of lets, where each generalization could search large
+// types again. Prints JSON:
+//
+//   bench_lets [MIN_SECONDS_PER_CASE] > results.json
+
+// A function of n curried parameters is passed to the parameter p, which is
+// then bound by n lets. Its type is built inside the first let, but ends up
+// at the outer level once p is bound to it.
+static std::string escaped(long n)
+{
+    std::string program = "let g = fun p -> let big = p(";
+    for (long i = 0; i < n; ++i)
+    {
+        program += "fun a" + std::to_string(i) + " -> ";
+    }
+    program += "a0) in\n";
+
+    for (long i = 0; i < n; ++i)
+    {
+        program += "let y" + std::to_string(i) + " = p in\n";
+    }
+
+    program += "one in g";
+    return program;
+}
+
+// n polymorphic functions, each wrapping the previous one
+static std::string wrapped(long n)
+{
+    std::string program = "let f0 = fun x -> x in\n";
+    for (long i = 1; i < n; ++i)
+    {
+        program += "let f" + std::to_string(i) + " = fun x -> f" + std::to_string(i - 1) + "(x) in\n";
+    }
+
+    program += "f" + std::to_string(n - 1) + "(one)";
+    return program;
+}
+
+int main(int argc, char** argv)
+{
+    bench::Suite suite(argc > 1 ? std::atof(argv[1]) : 0.05);
+
+    auto check = [](std::unique_ptr<bench::ParsedProgram>& f) {
+        SemanticAnalyzer semant;
+        semant.infer(f->ast.root());
+    };
+
+    for (long n : {100, 1000, 4000})
+    {
+        suite.run("check/escaped", n, [n] { return bench::parse(escaped(n)); }, check);
+        suite.run("check/wrapped", n, [n] { return bench::parse(wrapped(n)); }, check);
+    }
+
+    suite.writeJson(std::cout);
+
+    return 0;
+}
@@ -0,0 +1,119 @@
+#include "bench.hpp"
+#include "lexer.hpp"
+#include "scan.hpp"
+#include "source_file.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <string>
+
+// Lexer throughput over a multi-megabyte file, read straight from the mapping,
+// and that of its fast paths for whitespace and identifiers alone, with and
+// without SIMD
+//
+//   bench_lexer [MEGABYTES] [REPETITIONS]
+
+static std::string generate(size_t bytes)
+{
+    std::string program;
+    for (int i = 0; program.size() < bytes; ++i)
+    {
+        std::string name = "helper_function_" + std::to_string(i);
+        program += "let " + name + " = fun first_argument, second_argument ->\n";
+        program += "        add(first_argument, succ(second_argument)) in\n";
+    }
+
+    program += "zero\n";
+    return program;
+}
+
+using Skip = const char* (*)(const char* p, const char* end);
+
+// Walks the text as the lexer's fast paths would, leaving everything else to
+// be stepped over a byte at a time. Returns the number of runs, which must
+// not depend on how they are found.
+static size_t scan(std::string_view text, Skip space, Skip identifier)
+{
+    const char* p = text.data();
+    const char* end = p + text.size();
+
+    size_t runs = 0;
+    while (p != end)
+    {
+        const char* next = isIdentifierStart(*p) ? identifier(p + 1, end) : space(p, end);
+        if (next == p)
+        {
+            ++next;
+        }
+
+        p = next;
+        ++runs;
+    }
+
+    return runs;
+}
+
+// Seconds for a single walk of the text
+static double scanSeconds(std::string_view text, Skip space, Skip identifier, size_t& runs)
+{
+    bench::Timer timer;
+    runs = scan(text, space, identifier);
+    return timer.seconds();
+}
+
+int main(int argc, char** argv)
+{
+    size_t megabytes = argc > 1 ? std::atoi(argv[1]) : 16;
+    int repetitions = argc > 2 ? std::atoi(argv[2]) : 10;
+
+    std::string path = "/tmp/bench_lexer_" + std::to_string(getpid()) + ".hm";
+    {
+        std::ofstream out(path);
+        out << generate(megabytes << 20);
+    }
+
+    SourceFile source(path);
+    size_t tokens = 0;
+
+    bench::Timer timer;
+    for (int i = 0; i < repetitions; ++i)
+    {
+        Lexer lexer(source.text());
+        while (lexer.peek() != Token::Eof)
+        {
+            lexer.accept(lexer.peek());
+            ++tokens;
+        }
+    }
+    double seconds = timer.seconds();
+
+    // The two alternate, so that both see the same conditions, and each keeps
+    // its best time
+    size_t vectorRuns = 0;
+    size_t scalarRuns = 0;
+    double vector = std::numeric_limits<double>::infinity();
+    double scalar = vector;
+    for (int i = 0; i < repetitions; ++i)
+    {
+        vector = std::min(vector, scanSeconds(source.text(), skipSpace, skipIdentifier, vectorRuns));
+        scalar = std::min(scalar, scanSeconds(source.text(), skipSpaceScalar, skipIdentifierScalar, scalarRuns));
+    }
+
+    std::remove(path.c_str());
+
+    if (vectorRuns != scalarRuns)
+    {
+        std::cerr << "scans disagree\n";
+        return 1;
+    }
+
+    double size = double(source.text().size()) / (1 << 20);
+    std::cout << "MB/s: " << size * repetitions / seconds << "\n";
+    std::cout << "tokens/s: " << tokens / seconds << "\n";
+    std::cout << "scan MB/s: " << size / vector << " (scalar: " << size / scalar << ")\n";
+
+    return 0;
+}
@@ -0,0 +1,72 @@
+#include "bench.hpp"
+#include "module.hpp"
+#include "parser.hpp"
+#include "thread_pool.hpp"
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+
+// Wall-clock time to check a module of many declarations, as in `hmc --module`,
+// for increasing numbers of worker threads
+//
+//   bench_module [CHAINS] [LENGTH]
+
+// Independent chains of declarations, each referring to the previous one in its
+// chain and to a few shared ones at the top
+static std::string generate(int chains, int length)
+{
+    std::string program = "let apply = fun f, x -> f(x)\n";
+    program += "let pair = fun x, y -> fun f -> f(x, y)\n";
+
+    for (int chain = 0; chain < chains; ++chain)
+    {
+        std::string prefix = "c" + std::to_string(chain) + "_";
+        program += "let " + prefix + "0 = fun x -> add(x, one)\n";
+
+        for (int i = 1; i < length; ++i)
+        {
+            std::string previous = prefix + std::to_string(i - 1);
+            program += "let " + prefix + std::to_string(i) + " = fun x -> " +
+                       "let p = pair(apply(" + previous + ", x), x) in " +
+                       "p(fun a, b -> add(a, succ(b)))\n";
+        }
+    }
+
+    return program;
+}
+
+static double run(ast::Context& module, unsigned threads)
+{
+    bench::Timer timer;
+    {
+        ThreadPool pool(threads);
+        ModuleAnalyzer analyzer;
+        analyzer.infer(module, pool);
+    }
+
+    return timer.seconds();
+}
+
+int main(int argc, char** argv)
+{
+    int chains = argc > 1 ? std::atoi(argv[1]) : 64;
+    int length = argc > 2 ? std::atoi(argv[2]) : 200;
+
+    std::string program = generate(chains, length);
+    Parser parser(program);
+    ast::Context module = parser.parseModule();
+
+    unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    double baseline = run(module, 1);
+    std::cout << "threads: 1, seconds: " << baseline << ", speedup: 1\n";
+
+    for (unsigned threads = 2; threads <= cores; threads *= 2)
+    {
+        double seconds = run(module, threads);
+        std::cout << "threads: " << threads << ", seconds: " << seconds
+                  << ", speedup: " << baseline / seconds << "\n";
+    }
+
+    return 0;
+}
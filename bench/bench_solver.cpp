@@ -0,0 +1,89 @@
+#include "bench.hpp"
+#include "semantic.hpp"
+#include "solver.hpp"
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+
+// Checking large programs in a single pass (SemanticAnalyzer) and by solving
+// their constraints afterwards (ConstraintSolver). Prints JSON:
+//
+//   bench_solver [MIN_SECONDS_PER_CASE] > results.json
+
+// n polymorphic functions, each calling the previous one twice
+static std::string generic(long n)
+{
+    std::string program = "let first = fun x, y -> x in\n";
+    program += "let f0 = fun x, y -> first(x, y) in\n";
+    for (long i = 1; i < n; ++i)
+    {
+        std::string previous = "f" + std::to_string(i - 1);
+        program += "let f" + std::to_string(i) + " = fun x, y -> " + previous + "(" + previous + "(x, y), first(y, x)) in\n";
+    }
+
+    program += "f" + std::to_string(n - 1) + "(one, zero)";
+    return program;
+}
+
+// n monomorphic helpers, each applied to constants
+static std::string calls(long n)
+{
+    std::string program;
+    for (long i = 0; i < n; ++i)
+    {
+        std::string name = "f" + std::to_string(i);
+        program += "let " + name + " = fun x, y -> add(x, succ(y)) in\n";
+        program += "let g" + std::to_string(i) + " = " + name + "(one, " + name + "(zero, one)) in\n";
+    }
+
+    program += "zero";
+    return program;
+}
+
+// A single function whose body is n nested calls of its parameters
+static std::string nested(long n)
+{
+    std::string program = "fun f, x -> ";
+    for (long i = 0; i < n; ++i)
+    {
+        program += "f(x, ";
+    }
+
+    program += "x";
+    for (long i = 0; i < n; ++i)
+    {
+        program += ")";
+    }
+
+    return program;
+}
+
+int main(int argc, char** argv)
+{
+    bench::Suite suite(argc > 1 ? std::atof(argv[1]) : 0.05);
+
+    auto infer = [](std::unique_ptr<bench::ParsedProgram>& f) {
+        SemanticAnalyzer semant;
+        semant.infer(f->ast.root());
+    };
+
+    auto solve = [](std::unique_ptr<bench::ParsedProgram>& f) {
+        ConstraintSolver solver;
+        solver.infer(f->ast.root());
+    };
+
+    for (long n : {1000, 10000, 100000})
+    {
+        suite.run("infer/generic", n, [n] { return bench::parse(generic(n)); }, infer);
+        suite.run("solve/generic", n, [n] { return bench::parse(generic(n)); }, solve);
+        suite.run("infer/calls", n, [n] { return bench::parse(calls(n)); }, infer);
+        suite.run("solve/calls", n, [n] { return bench::parse(calls(n)); }, solve);
+        suite.run("infer/nested", n, [n] { return bench::parse(nested(n)); }, infer);
+        suite.run("solve/nested", n, [n] { return bench::parse(nested(n)); }, solve);
+    }
+
+    suite.writeJson(std::cout);
+
+    return 0;
+}
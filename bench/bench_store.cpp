@@ -0,0 +1,118 @@
+#include "bench.hpp"
+#include "type_store.hpp"
+#include "types.hpp"
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+// Compares the pointer-based Type hierarchy with the index-based TypeStore on
+// the work that dominates checking a large program: a big polymorphic
+// signature that is instantiated and unified at many use sites.
+//
+// The signature has `width` inputs, each an arrow nested `depth` deep over a
+// few type variables.
+
+struct PointerTypes
+{
+    typ::TypeArena arena;
+
+    typ::Type* var(int level) { return arena.makeUnbound(level); }
+
+    typ::Type* arrow(std::initializer_list<typ::Type*> inputs, typ::Type* output)
+    {
+        return arena.makeArrow(inputs, output);
+    }
+
+    typ::Type* arrow(const std::vector<typ::Type*>& inputs, typ::Type* output)
+    {
+        Span<typ::Type*> span = arena.makeInputs(inputs.size());
+        std::copy(inputs.begin(), inputs.end(), span.begin());
+        return arena.makeArrow(span, output);
+    }
+
+    typ::TypeScheme generalize(typ::Type* type) { return typ::generalize(arena, type, 0); }
+    typ::Type* instantiate(typ::TypeScheme scheme) { return typ::instantiate(arena, scheme, 1); }
+    bool unify(typ::Type* lhs, typ::Type* rhs) { return typ::unify(arena, lhs, rhs); }
+};
+
+struct IndexTypes
+{
+    typ::TypeStore store;
+
+    typ::TypeId var(int level) { return store.makeUnbound(level); }
+
+    typ::TypeId arrow(std::initializer_list<typ::TypeId> inputs, typ::TypeId output)
+    {
+        return store.makeArrow(inputs, output);
+    }
+
+    typ::TypeId arrow(const std::vector<typ::TypeId>& inputs, typ::TypeId output)
+    {
+        return store.makeArrow(inputs.data(), inputs.size(), output);
+    }
+
+    typ::TypeId generalize(typ::TypeId type) { return store.generalize(type, 0); }
+    typ::TypeId instantiate(typ::TypeId type) { return store.instantiate(type, 1); }
+    bool unify(typ::TypeId lhs, typ::TypeId rhs) { return store.unify(lhs, rhs); }
+};
+
+template <typename Types>
+void run(const char* name, int width, int depth, int uses)
+{
+    Types types;
+
+    auto a = types.var(1);
+    auto b = types.var(1);
+    auto c = types.var(1);
+
+    std::vector<decltype(a)> inputs;
+    for (int i = 0; i < width; ++i)
+    {
+        auto input = (i % 2) ? a : b;
+        for (int j = 0; j < depth; ++j)
+        {
+            input = types.arrow({input, c}, (j % 2) ? a : c);
+        }
+
+        inputs.push_back(input);
+    }
+
+    auto signature = types.generalize(types.arrow(inputs, a));
+
+    bench::CacheMisses misses;
+    misses.start();
+    bench::Timer timer;
+
+    // Every use site instantiates the signature and unifies it against another
+    // instance, which walks and binds the whole type
+    for (int i = 0; i < uses; ++i)
+    {
+        auto expected = types.instantiate(signature);
+        auto actual = types.instantiate(signature);
+
+        if (!types.unify(actual, expected))
+        {
+            std::cerr << "unexpected unification failure\n";
+            std::exit(1);
+        }
+    }
+
+    double seconds = timer.seconds();
+    long long cacheMisses = misses.stop();
+
+    std::cout << name << ": " << uses / seconds << " uses/s, "
+              << "cache misses: " << cacheMisses << "\n";
+}
+
+int main(int argc, char** argv)
+{
+    int width = argc > 1 ? std::atoi(argv[1]) : 64;
+    int depth = argc > 2 ? std::atoi(argv[2]) : 16;
+    int uses = argc > 3 ? std::atoi(argv[3]) : 2000;
+
+    std::cout << "width " << width << ", depth " << depth << ", " << uses << " uses\n";
+    run<PointerTypes>("pointer", width, depth, uses);
+    run<IndexTypes>("index", width, depth, uses);
+
+    return 0;
+}
@@ -0,0 +1,194 @@
+#include "bench.hpp"
+#include "types.hpp"
+#include <cstdlib>
+#include <memory>
+#include <sstream>
+#include <vector>
+
+// Microbenchmarks for the inference primitives in types.hpp, over types of
+// parameterised shape. Prints JSON, so that results can be tracked over time:
+//
+//   bench_types [MIN_SECONDS_PER_CASE] > results.json
+
+using namespace typ;
+
+// Fresh types for a single call of the operation being measured
+struct Fixture
+{
+    TypeArena arena;
+    Type* lhs = nullptr;
+    Type* rhs = nullptr;
+    Var* var = nullptr;
+    std::vector<Var*> vars;
+    TypeScheme scheme = {nullptr, 0};
+};
+
+using Shape = Type* (*)(TypeArena& arena, long n, int level);
+
+// |a1, a2, ..., an| -> a1
+Type* wide(TypeArena& arena, long n, int level)
+{
+    Span<Type*> inputs = arena.makeInputs(n);
+    for (auto& input : inputs)
+    {
+        input = arena.makeUnbound(level);
+    }
+
+    return arena.makeArrow(inputs, inputs[0]);
+}
+
+// a -> (a -> (a -> ... -> a)), n arrows deep
+Type* nested(TypeArena& arena, long n, int level)
+{
+    Type* a = arena.makeUnbound(level);
+
+    Type* type = a;
+    for (long i = 0; i < n; ++i)
+    {
+        type = arena.makeArrow({a}, type);
+    }
+
+    return type;
+}
+
+// v1 -> v2 -> ... -> vn, where each arrow is a link between type variables
+Var* chain(TypeArena& arena, long n)
+{
+    Var* head = arena.makeUnbound(0);
+
+    Var* var = head;
+    for (long i = 1; i < n; ++i)
+    {
+        Var* next = arena.makeUnbound(0);
+        var->link = next;
+        var = next;
+    }
+
+    return head;
+}
+
+// Instantiates the generalized version of a shape
+void runSchemes(bench::Suite& suite, const std::string& name, Shape shape)
+{
+    for (long n : {4, 64, 1024})
+    {
+        suite.run(name, n,
+            [&] {
+                auto fixture = std::make_unique<Fixture>();
+                fixture->scheme = generalize(fixture->arena, shape(fixture->arena, n, 1), 0);
+                return fixture;
+            },
+            [](std::unique_ptr<Fixture>& f) { instantiate(f->arena, f->scheme, 0); });
+    }
+}
+
+template <typename Op>
+void runShapes(bench::Suite& suite, const std::string& name, Op op,
+               Shape lhsShape, Shape rhsShape = nullptr)
+{
+    for (long n : {4, 64, 1024})
+    {
+        suite.run(name, n,
+            [&] {
+                auto fixture = std::make_unique<Fixture>();
+                fixture->lhs = lhsShape(fixture->arena, n, 1);
+                fixture->rhs = rhsShape ? rhsShape(fixture->arena, n, 1) : nullptr;
+                fixture->var = fixture->arena.makeUnbound(0);
+                return fixture;
+            },
+            [&](std::unique_ptr<Fixture>& fixture) { op(*fixture); });
+    }
+}
+
+int main(int argc, char** argv)
+{
+    bench::Suite suite(argc > 1 ? std::atof(argv[1]) : 0.05);
+
+    auto unifyOp = [](Fixture& f) { unify(f.arena, f.lhs, f.rhs); };
+    runShapes(suite, "unify/wide", unifyOp, wide, wide);
+    runShapes(suite, "unify/nested", unifyOp, nested, nested);
+
+    // bind itself is O(1): the level adjustment and occurs check it defers are
+    // timed with it, as generalization and error reporting would run them
+    auto bindOp = [](Fixture& f) {
+        bind(f.arena, f.var, f.lhs);
+        adjustLevels(f.arena, 0);
+        checkCycles(f.arena);
+    };
+    runShapes(suite, "bind+checks/wide", bindOp, wide);
+    runShapes(suite, "bind+checks/nested", bindOp, nested);
+
+    auto generalizeOp = [](Fixture& f) { generalize(f.arena, f.lhs, 0); };
+    runShapes(suite, "generalize/wide", generalizeOp, wide);
+    runShapes(suite, "generalize/nested", generalizeOp, nested);
+
+    // The wide shape has n distinct generic variables
+    runSchemes(suite, "instantiate/generics", wide);
+    runSchemes(suite, "instantiate/nested", nested);
+
+    // Chains linked by hand, far longer than bind() creates with union by rank.
+    // Each root() call halves the chain, so later calls walk less of it.
+    for (long n : {4, 64, 1024, 16384})
+    {
+        auto setup = [n] {
+            auto fixture = std::make_unique<Fixture>();
+            fixture->var = chain(fixture->arena, n);
+            return fixture;
+        };
+
+        suite.run("root/chain", n, setup, [](std::unique_ptr<Fixture>& f) { f->var->root(); });
+        suite.run("root/compressed", n,
+            [&] {
+                auto fixture = setup();
+                fixture->var->root();
+                return fixture;
+            },
+            [](std::unique_ptr<Fixture>& f) { f->var->root(); });
+    }
+
+    // n variables unified into one class a variable at a time, as when many
+    // uses of a value are constrained to the same type, then every root found
+    for (long n : {64, 1024, 16384})
+    {
+        auto setup = [n] {
+            auto fixture = std::make_unique<Fixture>();
+            for (long i = 0; i < n; ++i)
+            {
+                fixture->vars.push_back(fixture->arena.makeUnbound(0));
+            }
+            return fixture;
+        };
+
+        suite.run("root/merged", n, setup, [](std::unique_ptr<Fixture>& f) {
+            for (size_t i = 1; i < f->vars.size(); ++i)
+            {
+                unify(f->arena, f->vars[0], f->vars[i]);
+            }
+
+            for (auto* var : f->vars)
+            {
+                var->root();
+            }
+        });
+    }
+
+    auto printOp = [](Fixture& f) {
+        std::ostringstream out;
+        out << f.lhs;
+    };
+    runShapes(suite, "print/wide", printOp, wide);
+    runShapes(suite, "print/nested", printOp, nested);
+
+    // Comparing signatures without printing them
+    auto hashOp = [](Fixture& f) { hashType(f.lhs); };
+    runShapes(suite, "hash/wide", hashOp, wide);
+    runShapes(suite, "hash/nested", hashOp, nested);
+
+    auto alphaOp = [](Fixture& f) { alphaEquivalent(f.lhs, f.rhs); };
+    runShapes(suite, "alpha/wide", alphaOp, wide, wide);
+    runShapes(suite, "alpha/nested", alphaOp, nested, nested);
+
+    suite.writeJson(std::cout);
+
+    return 0;
+}
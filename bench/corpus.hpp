@@ -0,0 +1,240 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Generator of large programs for scaling benchmarks and tests. The same shape
+// and seed always give the same program, on any platform.
+
+namespace bench
+{
+
+// splitmix64, rather than <random>, whose distributions differ between
+// standard libraries
+class Random
+{
+public:
+    explicit Random(uint64_t seed)
+    : _state(seed)
+    {}
+
+    uint64_t next()
+    {
+        uint64_t x = (_state += 0x9e3779b97f4a7c15);
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111eb;
+        return x ^ (x >> 31);
+    }
+
+    // Uniform in [0, n)
+    size_t below(size_t n) { return next() % n; }
+
+    bool percent(int p) { return below(100) < size_t(p); }
+
+private:
+    uint64_t _state;
+};
+
+struct ProgramShape
+{
+    // Functions defined by the chain of lets which makes up the program
+    int definitions = 100;
+
+    // Lets nested in the body of each function
+    int depth = 3;
+
+    // Most parameters of a function (each has between one and this many)
+    int arity = 3;
+
+    // Calls in the value of each of those lets, each one's result passed to
+    // the next
+    int fanOut = 2;
+
+    // Percentage of the functions which are polymorphic. The others are
+    // functions of integers, which call polymorphic functions at Int and Bool.
+    int polymorphism = 30;
+
+    // Percentage of programs with a type error in one of their functions
+    int illTyped = 0;
+};
+
+struct GeneratedProgram
+{
+    std::string text;
+
+    // Number of AST nodes, and whether checking should succeed (with Int)
+    size_t nodes = 0;
+    bool wellTyped = true;
+};
+
+// Every function returns the type of its first parameter, or Int, so that any
+// earlier function can be called with an integer as the first argument, and a
+// polymorphic one with anything in the rest
+class ProgramGenerator
+{
+public:
+    ProgramGenerator(const ProgramShape& shape, uint64_t seed)
+    : _shape(shape), _random(seed)
+    {}
+
+    GeneratedProgram generate()
+    {
+        _program = GeneratedProgram();
+        _monomorphic = {{"add", 2}, {"succ", 1}};
+
+        // The prelude's id is monomorphic, so start from a generic one
+        _program.text = "let first = fun x0 -> x0 in\n";
+        _program.nodes = 3;
+        _polymorphic = {{"first", 1}};
+
+        _program.wellTyped = _shape.definitions == 0 || !_random.percent(_shape.illTyped);
+        int broken = _program.wellTyped ? -1 : int(_random.below(_shape.definitions));
+
+        for (int i = 0; i < _shape.definitions; ++i)
+        {
+            define("f" + std::to_string(i), i == broken);
+        }
+
+        // The last function (if any), called with integers
+        Function last = _shape.definitions ? _all.back() : Function{"succ", 1};
+        std::string call = last.name + "(" + atom("one");
+        for (int i = 1; i < last.arity; ++i)
+        {
+            call += ", " + atom("zero");
+        }
+
+        _program.text += call + ")\n";
+        _program.nodes += 2;
+
+        _all.clear();
+        return std::move(_program);
+    }
+
+private:
+    struct Function
+    {
+        std::string name;
+        int arity;
+    };
+
+    // A variable
+    std::string atom(std::string name)
+    {
+        _program.nodes += 1;
+        return name;
+    }
+
+    // let name = fun x0, ... -> let t0 = ... in ... in
+    void define(const std::string& name, bool broken)
+    {
+        int arity = 1 + _random.below(_shape.arity);
+        bool polymorphic = _random.percent(_shape.polymorphism);
+
+        _params.clear();
+        for (int i = 0; i < arity; ++i)
+        {
+            _params.push_back("x" + std::to_string(i));
+        }
+
+        std::string text = "let " + name + " = fun ";
+        for (int i = 0; i < arity; ++i)
+        {
+            text += (i ? ", " : "") + _params[i];
+        }
+        text += " ->";
+        _program.nodes += 2;
+
+        // Each let's value starts from the last, and ends up the same type:
+        // Int, or that of x0
+        std::string result = "x0";
+        for (int i = 0; i < _shape.depth; ++i)
+        {
+            std::string temp = "t" + std::to_string(i);
+            text += " let " + temp + " = " + chain(result, polymorphic) + " in";
+            _program.nodes += 1;
+
+            _params.push_back(temp);
+            result = temp;
+        }
+
+        if (broken)
+        {
+            text += " " + atom("add") + "(" + atom(result) + ", " + atom("true") + ")";
+            _program.nodes += 1;
+        }
+        else if (polymorphic)
+        {
+            text += " " + atom(result);
+        }
+        else
+        {
+            text += " " + atom("succ") + "(" + atom(result) + ")";
+            _program.nodes += 1;
+        }
+
+        _program.text += text + " in\n";
+
+        Function function = {name, arity};
+        (polymorphic ? _polymorphic : _monomorphic).push_back(function);
+        _all.push_back(function);
+    }
+
+    // Nested calls of earlier functions, innermost first. Polymorphic
+    // functions only call polymorphic ones, so their parameters stay generic.
+    std::string chain(std::string argument, bool polymorphic)
+    {
+        std::string expr = atom(argument);
+        for (int i = 0; i < _shape.fanOut; ++i)
+        {
+            bool generic = polymorphic || _random.percent(_shape.polymorphism);
+            const std::vector<Function>& callees = generic ? _polymorphic : _monomorphic;
+            const Function& callee = callees[_random.below(callees.size())];
+
+            std::string call = atom(callee.name) + "(" + expr;
+            for (int j = 1; j < callee.arity; ++j)
+            {
+                call += ", " + (generic ? anything() : integer());
+            }
+
+            expr = call + ")";
+            _program.nodes += 1;
+        }
+
+        return expr;
+    }
+
+    // Any variable in scope, or a constant
+    std::string anything()
+    {
+        static const char* constants[] = {"one", "zero", "true", "false"};
+        size_t i = _random.below(_params.size() + 4);
+        return atom(i < _params.size() ? _params[i] : constants[i - _params.size()]);
+    }
+
+    // Parameters and temporaries are integers in a function of integers
+    std::string integer()
+    {
+        size_t i = _random.below(_params.size() + 2);
+        if (i >= _params.size())
+        {
+            return atom(i % 2 ? "one" : "zero");
+        }
+
+        return atom(_params[i]);
+    }
+
+    ProgramShape _shape;
+    Random _random;
+
+    GeneratedProgram _program;
+
+    // Earlier functions which may be called, including the prelude's and first
+    std::vector<Function> _monomorphic;
+    std::vector<Function> _polymorphic;
+    std::vector<Function> _all;
+
+    // Variables in scope in the function being defined
+    std::vector<std::string> _params;
+};
+
+} // namespace bench
@@ -0,0 +1,25 @@
+#include "diagnostics.hpp"
+#include <algorithm>
+
+void Diagnostics::report(SourceRange range, std::string message)
+{
+    _diagnostics.push_back({range, std::move(message)});
+}
+
+void Diagnostics::sort(size_t first)
+{
+    std::stable_sort(_diagnostics.begin() + first, _diagnostics.end(), [](const Diagnostic& lhs, const Diagnostic& rhs) {
+        return lhs.range.begin < rhs.range.begin;
+    });
+}
+
+std::string format(const Diagnostic& diagnostic, std::string_view source)
+{
+    std::string_view before = source.substr(0, std::min<size_t>(diagnostic.range.begin, source.size()));
+
+    size_t line = std::count(before.begin(), before.end(), '\n') + 1;
+    size_t lineStart = before.rfind('\n');
+    size_t column = before.size() - (lineStart == std::string_view::npos ? 0 : lineStart + 1) + 1;
+
+    return std::to_string(line) + ":" + std::to_string(column) + ": " + diagnostic.message;
+}
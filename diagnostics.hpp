@@ -0,0 +1,44 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Part of the source text: the offsets of its first byte and of the byte after
+// its last
+struct SourceRange
+{
+    uint32_t begin = 0;
+    uint32_t end = 0;
+};
+
+struct Diagnostic
+{
+    SourceRange range;
+    std::string message;
+};
+
+// Collects the errors found while checking, so that checking can go on after
+// each one rather than unwinding at the first
+class Diagnostics
+{
+public:
+    void report(SourceRange range, std::string message);
+
+    // In the order reported, unless since sorted
+    const std::vector<Diagnostic>& all() const { return _diagnostics; }
+    size_t size() const { return _diagnostics.size(); }
+    bool empty() const { return _diagnostics.empty(); }
+
+    void clear() { _diagnostics.clear(); }
+
+    // Puts those reported since the first in order of position
+    void sort(size_t first = 0);
+
+private:
+    std::vector<Diagnostic> _diagnostics;
+};
+
+// "line:column: message", counting both from 1, where source is the text the
+// range refers to
+std::string format(const Diagnostic& diagnostic, std::string_view source);
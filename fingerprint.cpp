@@ -0,0 +1,151 @@
+#include "fingerprint.hpp"
+#include "hash.hpp"
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+uint64_t hashSource(std::string_view text)
+{
+    // Eight bytes at a time, then the remainder padded with zeros
+    uint64_t hash = text.size();
+
+    size_t i = 0;
+    for (; i + 8 <= text.size(); i += 8)
+    {
+        uint64_t word;
+        std::memcpy(&word, text.data() + i, 8);
+        hash = mix(hash, word);
+    }
+
+    uint64_t word = 0;
+    std::memcpy(&word, text.data() + i, text.size() - i);
+    return mix(hash, word);
+}
+
+enum : uint64_t { kVarHash = 1, kCallHash, kFunHash, kLetHash };
+
+Fingerprinter::Fingerprinter(const typ::TypeEnvironment& env)
+{
+    for (int slot = 0; slot < env.size(); ++slot)
+    {
+        _bindings.push_back({hashName(env.name(slot)), isClosed(env.type(slot))});
+    }
+}
+
+void Fingerprinter::fingerprint(ast::Expr* node)
+{
+    descend(node);
+    while (!_frames.empty())
+    {
+        Frame frame = _frames.pop();
+        _state = frame.state;
+        frame.node->accept(this);
+    }
+
+    _results.clear();
+}
+
+void Fingerprinter::visit(ast::Var* node)
+{
+    const Binding& binding = _bindings[node->slot];
+
+    // Open bindings contribute only their name: whatever refers to them gets no
+    // fingerprint anyway, unless they are bound inside it
+    uint64_t hash = mix(mix(kVarHash, hashName(node->name.str())), binding.closed ? binding.fingerprint : 0);
+    int open = binding.closed ? INT_MAX : node->slot;
+
+    _results.push({hash, open, 1});
+}
+
+void Fingerprinter::visit(ast::Call* node)
+{
+    size_t count = node->arguments.size();
+    if (size_t(_state) <= count)
+    {
+        suspend(node, _state + 1);
+        descend(_state == 0 ? node->function : node->arguments[_state - 1]);
+        return;
+    }
+
+    // The function, followed by the arguments
+    size_t base = _results.size() - count - 1;
+    Summary summary{kCallHash, INT_MAX, 1};
+    for (size_t i = base; i < _results.size(); ++i)
+    {
+        summary.hash = mix(summary.hash, _results[i].hash);
+        summary.open = std::min(summary.open, _results[i].open);
+        summary.size += _results[i].size;
+    }
+
+    _results.truncate(base);
+    _results.push(summary);
+}
+
+void Fingerprinter::visit(ast::Fun* node)
+{
+    if (_state == 0)
+    {
+        // Parameters are never closed: their types are only known in context
+        for (size_t i = 0; i < node->parameters.size(); ++i)
+        {
+            _bindings.push_back({0, false});
+        }
+
+        suspend(node, 1);
+        descend(node->body);
+        return;
+    }
+
+    _bindings.resize(_bindings.size() - node->parameters.size());
+
+    Summary body = _results.pop();
+
+    Summary summary{kFunHash, body.open, body.size + 1};
+    for (ast::Symbol param : node->parameters)
+    {
+        summary.hash = mix(summary.hash, hashName(param.str()));
+    }
+    summary.hash = mix(summary.hash, body.hash);
+
+    _results.push(summary);
+}
+
+void Fingerprinter::visit(ast::Let* node)
+{
+    switch (_state)
+    {
+        case 0:
+            suspend(node, 1);
+            descend(node->value);
+            break;
+
+        // The value's summary stays on the stack until the body is done
+        case 1:
+        {
+            const Summary& value = _results.top();
+            bool closed = value.open >= int(_bindings.size());
+
+            // 0 is reserved for values without a fingerprint
+            node->fingerprint = closed ? (value.hash | 1) : 0;
+            node->valueSize = value.size;
+
+            _bindings.push_back({value.hash, closed});
+
+            suspend(node, 2);
+            descend(node->body);
+            break;
+        }
+
+        case 2:
+        {
+            _bindings.pop_back();
+
+            Summary body = _results.pop();
+            Summary value = _results.pop();
+
+            uint64_t hash = mix(mix(mix(kLetHash, hashName(node->name.str())), value.hash), body.hash);
+            _results.push({hash, std::min(value.open, body.open), value.size + body.size + 1});
+            break;
+        }
+    }
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include "ast.hpp"
+#include "type_env.hpp"
+#include "work_stack.hpp"
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// Fingerprints the value of every let in a resolved program (see Resolver), so
+// that the types of unchanged values can be reused from a TypeCache
+//
+// A fingerprint covers the source of the value and, for each variable it
+// refers to, the fingerprint of the binding. Editing a binding therefore
+// changes the fingerprints of everything which depends on it, and nothing else.
+//
+// Only values whose generalized type is closed get a fingerprint: those which
+// refer to nothing but closed bindings. A value which refers to an enclosing
+// function parameter (or to a binding which does) shares type variables with
+// its context, so its type cannot be reused elsewhere.
+class Fingerprinter : public ast::Visitor
+{
+public:
+    // The identifiers already bound in env are visible to the program
+    Fingerprinter(const typ::TypeEnvironment& env);
+
+    void fingerprint(ast::Expr* node);
+
+    void visit(ast::Var* node) override;
+    void visit(ast::Call* node) override;
+    void visit(ast::Fun* node) override;
+    void visit(ast::Let* node) override;
+
+private:
+    // As in Resolver, nodes are visited from an explicit stack
+    void suspend(ast::Expr* node, int state) { _frames.push({node, state}); }
+    void descend(ast::Expr* child) { _frames.push({child, 0}); }
+
+    struct Frame
+    {
+        ast::Expr* node;
+        int state;
+    };
+
+    WorkStack<Frame> _frames;
+    int _state = 0;
+
+    // Indexed by slot
+    struct Binding
+    {
+        uint64_t fingerprint;
+        bool closed;
+    };
+
+    std::vector<Binding> _bindings;
+
+    // For each visited subtree: its hash, the lowest slot it refers to whose
+    // binding is not closed (INT_MAX if none), and its number of nodes
+    struct Summary
+    {
+        uint64_t hash;
+        int open;
+        uint32_t size;
+    };
+
+    WorkStack<Summary> _results;
+};
+
+// Fast, non-cryptographic hash of a whole source text, to detect any change to
+// it (see Interface)
+uint64_t hashSource(std::string_view text);
@@ -0,0 +1,26 @@
+#pragma once
+#include <cstdint>
+#include <string_view>
+
+// Order-sensitive combination of 64-bit hashes
+inline uint64_t mix(uint64_t hash, uint64_t value)
+{
+    uint64_t x = hash ^ (value * 0x9e3779b97f4a7c15);
+    x ^= x >> 32;
+    x *= 0xd6e8feb86659fd93;
+    x ^= x >> 32;
+    return x;
+}
+
+// FNV-1a, so that hashes do not depend on the standard library, and are the
+// same in every run
+inline uint64_t hashName(std::string_view name)
+{
+    uint64_t hash = 0xcbf29ce484222325;
+    for (char c : name)
+    {
+        hash = (hash ^ uint8_t(c)) * 0x100000001b3;
+    }
+
+    return hash;
+}
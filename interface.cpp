@@ -0,0 +1,325 @@
+#include "interface.hpp"
+#include "work_stack.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+using namespace typ;
+
+static const char kMagic[4] = {'H', 'M', 'I', '\0'};
+static const uint32_t kVersion = 2;
+
+// Nodes start with their tag, followed by:
+//   constant: offset and length of its name
+//   variable: its number (each generic variable is a single node)
+//   arrow: its arity, the nodes of its inputs, then the node of its output
+// Each binding is the offset and length of its name, then the node of its type.
+// Schemes number their variables densely, so the number of quantifiers of each
+// is one more than the highest number in its type, and is not stored.
+
+Interface::Interface(const std::string& path)
+: _file(path)
+{}
+
+const Interface::Header* Interface::header() const
+{
+    std::string_view data = _file.text();
+    if (data.size() < sizeof(Header))
+    {
+        return nullptr;
+    }
+
+    auto header = reinterpret_cast<const Header*>(data.data());
+    if (std::memcmp(header->magic, kMagic, sizeof(kMagic)) != 0 || header->version != kVersion)
+    {
+        return nullptr;
+    }
+
+    uint64_t size = sizeof(Header) + 4 * (uint64_t(header->words) + 3 * uint64_t(header->bindings)) + header->chars;
+    return size == data.size() ? header : nullptr;
+}
+
+bool Interface::matches(uint64_t sourceHash) const
+{
+    const Header* header = this->header();
+    return header && header->sourceHash == sourceHash;
+}
+
+void Interface::load(TypeArena& arena, TypeEnvironment& env) const
+{
+    const Header* header = this->header();
+    if (!header)
+    {
+        throw std::runtime_error("malformed interface file");
+    }
+
+    auto words = reinterpret_cast<const uint32_t*>(header + 1);
+    auto bindings = words + header->words;
+    auto chars = reinterpret_cast<const char*>(bindings + 3 * header->bindings);
+
+    // Every word is checked before it is used, so a damaged file cannot
+    // reference anything outside itself
+    const uint32_t* next = words;
+    const uint32_t* end = bindings;
+    std::vector<Type*> nodes;
+    nodes.reserve(header->nodes);
+
+    // Quantifiers of a scheme whose type is each node
+    std::vector<uint32_t> quantifiers;
+    quantifiers.reserve(header->nodes);
+
+    auto word = [&]() {
+        if (next == end)
+        {
+            throw std::runtime_error("malformed interface file");
+        }
+
+        return *next++;
+    };
+
+    // A node which has already been decoded
+    auto reference = [&]() {
+        uint32_t index = word();
+        if (index >= nodes.size())
+        {
+            throw std::runtime_error("malformed interface file");
+        }
+
+        return index;
+    };
+
+    auto name = [&]() {
+        uint32_t offset = word();
+        uint32_t length = word();
+        if (offset > header->chars || length > header->chars - offset)
+        {
+            throw std::runtime_error("malformed interface file");
+        }
+
+        return std::string_view(chars + offset, length);
+    };
+
+    while (next != end)
+    {
+        switch (word())
+        {
+            case kConstant:
+                nodes.push_back(arena.makeConstant(name()));
+                quantifiers.push_back(0);
+                break;
+
+            case kVar:
+            {
+                // Bounding the number bounds the work of instantiating a
+                // scheme, even in a damaged file
+                uint32_t number = word();
+                if (number >= header->nodes)
+                {
+                    throw std::runtime_error("malformed interface file");
+                }
+
+                nodes.push_back(arena.makeGeneric(number));
+                quantifiers.push_back(number + 1);
+                break;
+            }
+
+            case kArrow:
+            {
+                uint32_t arity = word();
+                if (arity > size_t(end - next))
+                {
+                    throw std::runtime_error("malformed interface file");
+                }
+
+                uint32_t count = 0;
+                Span<Type*> inputs = arena.makeInputs(arity);
+                for (Type*& input : inputs)
+                {
+                    uint32_t index = reference();
+                    input = nodes[index];
+                    count = std::max(count, quantifiers[index]);
+                }
+
+                uint32_t output = reference();
+                nodes.push_back(arena.makeArrow(inputs, nodes[output]));
+                quantifiers.push_back(std::max(count, quantifiers[output]));
+                break;
+            }
+
+            default:
+                throw std::runtime_error("malformed interface file");
+        }
+    }
+
+    if (nodes.size() != header->nodes)
+    {
+        throw std::runtime_error("malformed interface file");
+    }
+
+    // Nothing is bound unless the whole file is valid
+    std::vector<std::pair<std::string_view, TypeScheme>> decoded;
+
+    next = bindings;
+    end = bindings + 3 * header->bindings;
+    while (next != end)
+    {
+        std::string_view ident = name();
+        uint32_t index = reference();
+        decoded.emplace_back(ident, TypeScheme{nodes[index], quantifiers[index]});
+    }
+
+    for (auto& binding : decoded)
+    {
+        env.insert(binding.first, binding.second);
+    }
+}
+
+void Interface::write(const std::string& path, uint64_t sourceHash, const TypeEnvironment& env)
+{
+    std::vector<uint32_t> words;
+    std::string chars;
+    uint32_t nodes = 0;
+
+    // Shared subtrees are written once. Distinct objects may stand for the
+    // same generic variable, so variables are identified by their index.
+    std::unordered_map<Type*, uint32_t> written;
+    std::unordered_map<int64_t, uint32_t> vars;
+
+    auto name = [&](std::string_view name) {
+        words.push_back(chars.size());
+        words.push_back(name.size());
+        chars += name;
+    };
+
+    // An arrow being written: its next component to visit, and the position of
+    // the nodes of its components on the results stack (output first)
+    struct Frame
+    {
+        Arrow* arrow;
+        size_t next;
+        size_t base;
+    };
+
+    WorkStack<Frame> frames;
+    WorkStack<uint32_t> results;
+
+    auto visit = [&](Type* type) {
+        type = type->root();
+
+        auto i = written.find(type);
+        if (i != written.end())
+        {
+            results.push(i->second);
+            return;
+        }
+
+        switch (type->tag())
+        {
+            case kConstant:
+                words.push_back(kConstant);
+                name(static_cast<Constant*>(type)->name);
+                written.emplace(type, nodes);
+                results.push(nodes++);
+                break;
+
+            case kArrow:
+                frames.push({static_cast<Arrow*>(type), 0, results.size()});
+                break;
+
+            case kVar:
+            {
+                Var* var = static_cast<Var*>(type);
+                if (!var->isGeneric())
+                {
+                    throw std::runtime_error("type has unbound variables");
+                }
+
+                auto j = vars.find(var->index);
+                if (j == vars.end())
+                {
+                    words.push_back(kVar);
+                    words.push_back(var->index);
+                    j = vars.emplace(var->index, nodes++).first;
+                }
+
+                results.push(j->second);
+                break;
+            }
+        }
+    };
+
+    std::vector<uint32_t> types;
+    for (int slot = 0; slot < env.size(); ++slot)
+    {
+        visit(env.type(slot));
+        while (!frames.empty())
+        {
+            Frame& frame = frames.top();
+            Arrow* arrow = frame.arrow;
+            size_t arity = arrow->inputs.size();
+
+            if (frame.next <= arity)
+            {
+                Type* component = (frame.next == 0) ? arrow->output : arrow->inputs[frame.next - 1];
+                ++frame.next;
+
+                visit(component);
+                continue;
+            }
+
+            size_t base = frame.base;
+            frames.pop();
+
+            words.push_back(kArrow);
+            words.push_back(arity);
+            words.insert(words.end(), results.data() + base + 1, results.data() + base + 1 + arity);
+            words.push_back(results[base]);
+
+            written.emplace(arrow, nodes);
+            results.truncate(base);
+            results.push(nodes++);
+        }
+
+        types.push_back(results.pop());
+    }
+
+    Header header = {};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.sourceHash = sourceHash;
+    header.nodes = nodes;
+    header.bindings = env.size();
+    header.words = words.size();
+
+    for (int slot = 0; slot < env.size(); ++slot)
+    {
+        name(env.name(slot));
+        words.push_back(types[slot]);
+    }
+
+    header.chars = chars.size();
+
+    // Written aside and then renamed over the old file
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(words.data()), words.size() * sizeof(uint32_t));
+        out.write(chars.data(), chars.size());
+
+        if (!out.flush())
+        {
+            throw std::runtime_error("cannot write file: " + path);
+        }
+    }
+
+    if (std::rename(temporary.c_str(), path.c_str()) != 0)
+    {
+        std::remove(temporary.c_str());
+        throw std::runtime_error("cannot write file: " + path);
+    }
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include "source_file.hpp"
+#include "type_env.hpp"
+#include "types.hpp"
+#include <cstdint>
+#include <string>
+
+// Binary interface file: the type schemes of a module's declarations,
+// together with a hash of its source (see hashSource), so that an unchanged
+// module need not be parsed or checked again
+//
+// After a fixed header, types are stored as a table of nodes in 32-bit words,
+// each after its components, so that shared subtrees are stored once. Names
+// follow as a single block of characters. Words are in native byte order: the
+// files are caches for the machine which wrote them, not a portable format.
+class Interface
+{
+public:
+    // Maps the file. Throws if it cannot be read.
+    Interface(const std::string& path);
+
+    // Is the file a well-formed interface for a source with this hash?
+    bool matches(uint64_t sourceHash) const;
+
+    // Binds every declaration in env, with its type created in arena. The
+    // names of the bindings point into the file, so the interface must
+    // outlive env. The types (constant names included) are copied into arena,
+    // and do not depend on it. Throws if the file is malformed.
+    void load(typ::TypeArena& arena, typ::TypeEnvironment& env) const;
+
+    // Writes the bindings of env, which must all have closed types. The file
+    // is replaced in one step, so a reader never sees part of it.
+    static void write(const std::string& path, uint64_t sourceHash, const typ::TypeEnvironment& env);
+
+private:
+    struct Header
+    {
+        char magic[4];
+        uint32_t version;
+        uint64_t sourceHash;
+        uint32_t nodes;
+        uint32_t bindings;
+        uint32_t words;
+        uint32_t chars;
+    };
+
+    const Header* header() const;
+
+    SourceFile _file;
+};
@@ -1,21 +1,28 @@
 #pragma once
 #include "token.hpp"
-#include <string>
+#include <string_view>
 
 // Converts a string into a sequence of tokens
+//
+// The program text is not copied, and tokens point into it, so it must outlive
+// the lexer and any tokens that it returns
+//
+// Text which is not a token becomes an Err token (pointing at its first byte),
+// after which the lexer never advances.
 class Lexer
 {
 public:
-    Lexer(const std::string& program);
+    Lexer(std::string_view program);
+
+    // The next token
+    const Token& current() const { return _token; }
 
     Token::TokenType peek();
     Token expect(Token::TokenType type);
     bool accept(Token::TokenType type);
 
 private:
-    std::string _program;
-
-    Token _token;
+    Token _token = {Token::Eof, {}};
     void advance();
 
     // Current token
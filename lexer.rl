@@ -1,4 +1,6 @@
 #include "lexer.hpp"
+#include "scan.hpp"
+#include <cstddef>
 #include <cstring>
 #include <iostream>
 
@@ -6,7 +8,7 @@
 
 #define CAPTURE(t) \
     _token.type = t; \
-    _token.lexeme = std::string(ts, te - ts);
+    _token.lexeme = std::string_view(ts, te - ts);
 
 %%{
     machine lexer;
@@ -37,32 +39,57 @@
 
 %% write data;
 
-Lexer::Lexer(const std::string& program)
-: _program(program)
+Lexer::Lexer(std::string_view program)
 {
     %% write init;
 
-    p = _program.c_str();
-    pe = p + _program.size();
+    p = program.data();
+    pe = p + program.size();
     eof = pe;
 
     advance();
 }
 
+// Keywords are left to the machine, so any longer identifier is not one
+static const ptrdiff_t kLongestKeyword = 6;
+
 void Lexer::advance()
 {
+    if (_token.type == Token::Err)
+    {
+        return;
+    }
+
+    // Whitespace, and identifiers too long to be keywords, are found several
+    // bytes at a time. Everything else is left to the machine, which is at the
+    // start of a token between calls.
+    p = skipSpace(p, pe);
+    if (p < pe && isIdentifierStart(*p))
+    {
+        const char* end = skipIdentifier(p + 1, pe);
+        if (end - p > kLongestKeyword)
+        {
+            ts = p;
+            te = p = end;
+            CAPTURE(Token::Ident);
+            return;
+        }
+    }
+
     if (p < pe)
     {
         %% write exec;
 
         if (cs == lexer_error)
         {
-            throw std::runtime_error("lexer error");
+            _token.type = Token::Err;
+            _token.lexeme = std::string_view(p, p < pe ? 1 : 0);
         }
     }
     else
     {
         _token.type = Token::Eof;
+        _token.lexeme = std::string_view(pe, 0);
     }
 }
 
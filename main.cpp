@@ -1,16 +1,298 @@
+#include "fingerprint.hpp"
+#include "interface.hpp"
+#include "module.hpp"
 #include "parser.hpp"
 #include "semantic.hpp"
+#include "source_file.hpp"
+#include "thread_pool.hpp"
 #include <cassert>
+#include <condition_variable>
+#include <fstream>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
 
-int main()
+struct Result
 {
-    Parser parser("add(one, one)");
-    ast::Context ast = parser.parse();
+    bool done = false;
 
-    SemanticAnalyzer semant;
-    typ::Type* type = semant.infer(ast.root());
-    std::cout << type << "\n";
+    // Inferred type, if there were no errors
+    std::string output;
+    std::vector<std::string> errors;
 
-    return 0;
+    // Inference statistics, if requested
+    std::string stats;
+};
+
+// Type-checks a single file. Runs on a worker thread, so everything it uses
+// (including the parser and analyzer) is private to the call.
+//
+// Errors in the program are collected rather than thrown, so that all of them
+// are reported (though parsing stops at the first syntax error).
+static Result check(const std::string& path, bool stats)
+{
+    Result result;
+
+    try
+    {
+        // The parser reads straight from the mapped file
+        SourceFile source(path);
+        Diagnostics diagnostics;
+        Parser parser(source.text());
+        ast::Context ast = parser.parse(diagnostics);
+
+        SemanticAnalyzer semant;
+        typ::Type* type = ast.root() ? semant.infer(ast.root(), diagnostics) : nullptr;
+
+        for (const Diagnostic& diagnostic : diagnostics.all())
+        {
+            result.errors.push_back(format(diagnostic, source.text()));
+        }
+
+        if (type)
+        {
+            std::stringstream ss;
+            ss << type;
+            result.output = ss.str();
+        }
+
+        if (stats)
+        {
+            std::stringstream ss;
+            ss << semant.stats();
+            result.stats = ss.str();
+        }
+    }
+    catch (std::exception& e)
+    {
+        result.errors.push_back(e.what());
+    }
+
+    return result;
+}
+
+// The interface written by an earlier run, if the module is unchanged since.
+// Its declarations are bound in env.
+static std::unique_ptr<Interface> loadInterface(const std::string& path, uint64_t sourceHash,
+                                                typ::TypeArena& arena, typ::TypeEnvironment& env)
+{
+    try
+    {
+        auto interface = std::make_unique<Interface>(path);
+        if (interface->matches(sourceHash))
+        {
+            interface->load(arena, env);
+            return interface;
+        }
+    }
+    catch (std::exception&)
+    {
+        // Missing or damaged interfaces are simply rebuilt
+    }
+
+    return nullptr;
+}
+
+// Type-checks each module in turn, inferring the binding groups of each in
+// parallel, and prints the type of every declaration
+//
+// The types are saved to an interface file next to the module (FILE.hmi), and
+// reused without parsing or checking as long as the module is unchanged.
+static bool checkModules(const std::vector<std::string>& paths, ThreadPool& pool)
+{
+    bool failed = false;
+
+    for (const std::string& path : paths)
+    {
+        std::string prefix = paths.size() == 1 ? "" : path + ": ";
+
+        try
+        {
+            SourceFile source(path);
+            uint64_t sourceHash = hashSource(source.text());
+            std::string interfacePath = path + ".hmi";
+
+            // Declarations in order, with their schemes
+            typ::TypeArena types;
+            typ::TypeEnvironment env;
+            ast::Context module;
+            ModuleAnalyzer analyzer;
+
+            std::unique_ptr<Interface> interface = loadInterface(interfacePath, sourceHash, types, env);
+            if (!interface)
+            {
+                Parser parser(source.text());
+                module = parser.parseModule();
+
+                std::vector<typ::TypeScheme> inferred = analyzer.infer(module, pool);
+                Span<ast::Declaration> declarations = module.declarations();
+                for (size_t i = 0; i < declarations.size(); ++i)
+                {
+                    env.insert(declarations[i].name.str(), inferred[i]);
+                }
+
+                // The result stands even if it cannot be saved
+                try
+                {
+                    Interface::write(interfacePath, sourceHash, env);
+                }
+                catch (std::exception& e)
+                {
+                    std::cerr << path << ": warning: " << e.what() << "\n";
+                }
+            }
+
+            for (int slot = 0; slot < env.size(); ++slot)
+            {
+                std::cout << prefix << env.name(slot) << ": " << env.type(slot) << "\n";
+            }
+        }
+        catch (std::exception& e)
+        {
+            std::cerr << path << ": " << e.what() << "\n";
+            failed = true;
+        }
+    }
+
+    return !failed;
+}
+
+// A manifest lists one input file per line
+static bool readManifest(const std::string& path, std::vector<std::string>& paths)
+{
+    std::ifstream in(path);
+    if (!in)
+    {
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(in, line))
+    {
+        if (!line.empty())
+        {
+            paths.push_back(line);
+        }
+    }
+
+    return true;
+}
+
+static int usage(const char* program)
+{
+    std::cerr << "usage: " << program << " [-j THREADS] [--stats | --module] [--manifest FILE] FILE...\n";
+    return 1;
+}
+
+int main(int argc, char** argv)
+{
+    unsigned threads = 0;
+    bool stats = false;
+    bool modules = false;
+    std::vector<std::string> paths;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "-j" && i + 1 < argc)
+        {
+            threads = std::atoi(argv[++i]);
+        }
+        else if (arg == "--manifest" && i + 1 < argc)
+        {
+            if (!readManifest(argv[++i], paths))
+            {
+                std::cerr << "cannot read manifest: " << argv[i] << "\n";
+                return 1;
+            }
+        }
+        else if (arg == "--stats")
+        {
+            if (!typ::Stats::enabled)
+            {
+                std::cerr << "--stats requires a build with HM_STATS enabled\n";
+                return 1;
+            }
+
+            stats = true;
+        }
+        else if (arg == "--module")
+        {
+            modules = true;
+        }
+        else if (arg.size() > 1 && arg[0] == '-')
+        {
+            return usage(argv[0]);
+        }
+        else
+        {
+            paths.push_back(arg);
+        }
+    }
+
+    // Statistics are per analyzer, and a module has many
+    if (paths.empty() || (stats && modules))
+    {
+        return usage(argv[0]);
+    }
+
+    if (modules)
+    {
+        ThreadPool pool(threads);
+        return checkModules(paths, pool) ? 0 : 1;
+    }
+
+    // Files are checked concurrently, but results are reported in input order
+    std::vector<Result> results(paths.size());
+    std::mutex mutex;
+    std::condition_variable ready;
+
+    ThreadPool pool(threads);
+    for (size_t i = 0; i < paths.size(); ++i)
+    {
+        pool.submit([&, i] {
+            Result result = check(paths[i], stats);
+
+            std::lock_guard<std::mutex> lock(mutex);
+            results[i] = std::move(result);
+            results[i].done = true;
+            ready.notify_all();
+        });
+    }
+
+    bool failed = false;
+    for (size_t i = 0; i < paths.size(); ++i)
+    {
+        // Printing happens after unlocking, so that workers are not held up
+        Result result;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            ready.wait(lock, [&] { return results[i].done; });
+            result = std::move(results[i]);
+        }
+
+        if (!result.errors.empty())
+        {
+            for (const std::string& error : result.errors)
+            {
+                std::cerr << paths[i] << ": " << error << "\n";
+            }
+            failed = true;
+        }
+        else if (paths.size() == 1)
+        {
+            std::cout << result.output << "\n";
+        }
+        else
+        {
+            std::cout << paths[i] << ": " << result.output << "\n";
+        }
+
+        std::cout << result.stats;
+    }
+
+    return failed ? 1 : 0;
 }
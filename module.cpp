@@ -0,0 +1,288 @@
+#include "module.hpp"
+#include "prelude.hpp"
+#include "resolver.hpp"
+#include "semantic.hpp"
+#include "work_stack.hpp"
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <stdexcept>
+
+using typ::TypeScheme;
+
+std::vector<TypeScheme> ModuleAnalyzer::infer(ast::Context& module, ThreadPool& pool)
+{
+    Span<ast::Declaration> declarations = module.declarations();
+    int count = declarations.size();
+    _errorDeclaration = -1;
+
+    // Find the declarations which each value refers to, by resolving it against
+    // the names which every analyzer binds followed by every declaration. Only
+    // the slots matter here, not the types.
+    typ::TypeEnvironment env(&prelude().env);
+    for (std::string_view name : monomorphicNames)
+    {
+        env.insert(name, TypeScheme{nullptr, 0});
+    }
+
+    int first = env.size();
+
+    std::vector<bool> declared(module.symbolCount());
+    for (ast::Declaration& declaration : declarations)
+    {
+        if (declared[declaration.name.id()])
+        {
+            throw std::runtime_error("duplicate declaration: " + std::string(declaration.name.str()));
+        }
+
+        declared[declaration.name.id()] = true;
+        env.insert(declaration.name.str(), TypeScheme{nullptr, 0});
+    }
+
+    std::vector<std::vector<int>> references(count);
+    {
+        Resolver resolver(env);
+        std::vector<int> slots;
+
+        for (int i = 0; i < count; ++i)
+        {
+            slots.clear();
+            try
+            {
+                resolver.resolve(declarations[i].value, slots);
+            }
+            catch (std::exception& e)
+            {
+                throw std::runtime_error(std::string(declarations[i].name.str()) + ": " + e.what());
+            }
+
+            for (int slot : slots)
+            {
+                if (slot >= first)
+                {
+                    references[i].push_back(slot - first);
+                }
+            }
+
+            std::sort(references[i].begin(), references[i].end());
+            references[i].erase(std::unique(references[i].begin(), references[i].end()), references[i].end());
+        }
+    }
+
+    std::vector<Group> groups = group(references);
+
+    // Number of groups which each one refers to that are not yet done
+    std::vector<std::atomic<int>> waiting(groups.size());
+    for (Group& group : groups)
+    {
+        for (int dependent : group.dependents)
+        {
+            ++waiting[dependent];
+        }
+    }
+
+    // Published types are only written before the groups which refer to them
+    // are started, and never change afterwards, so reading them needs no lock
+    std::vector<TypeScheme> types(count);
+
+    std::function<void(size_t)> start = [&](size_t index) {
+        pool.submit([&, index] {
+            Group& group = groups[index];
+
+            try
+            {
+                SemanticAnalyzer semant;
+                for (int declaration : group.imports)
+                {
+                    semant.import(declarations[declaration].name.str(), types[declaration]);
+                }
+
+                std::vector<ast::Declaration> members;
+                for (int declaration : group.members)
+                {
+                    members.push_back(declarations[declaration]);
+                }
+
+                std::vector<TypeScheme> inferred = semant.inferGroup(members);
+
+                std::lock_guard<std::mutex> lock(_mutex);
+                for (size_t i = 0; i < members.size(); ++i)
+                {
+                    types[group.members[i]] = {copy(_types, inferred[i].type), inferred[i].quantifiers};
+                }
+            }
+            catch (std::exception& e)
+            {
+                // Groups which refer to this one are never started
+                fail(group.members[0], e.what());
+                return;
+            }
+
+            for (int dependent : group.dependents)
+            {
+                if (--waiting[dependent] == 0)
+                {
+                    start(dependent);
+                }
+            }
+        });
+    };
+
+    // Found before starting any, since the first to finish start others
+    std::vector<size_t> ready;
+    for (size_t i = 0; i < groups.size(); ++i)
+    {
+        if (waiting[i] == 0)
+        {
+            ready.push_back(i);
+        }
+    }
+
+    for (size_t index : ready)
+    {
+        start(index);
+    }
+
+    pool.wait();
+
+    if (_errorDeclaration != -1)
+    {
+        std::string name(declarations[_errorDeclaration].name.str());
+        throw std::runtime_error(name + ": " + _error);
+    }
+
+    return types;
+}
+
+// Tarjan's algorithm, with an explicit stack. A group is complete when the
+// search returns to its first declaration, and by then every group it refers
+// to is complete as well.
+std::vector<ModuleAnalyzer::Group> ModuleAnalyzer::group(const std::vector<std::vector<int>>& references)
+{
+    int count = references.size();
+
+    // Order of discovery, and the earliest declaration still on the stack which
+    // is reachable from each one
+    std::vector<int> index(count, -1);
+    std::vector<int> lowlink(count);
+
+    // Group of each declaration, or -1 while it is on the stack
+    std::vector<int> component(count, -1);
+    WorkStack<int> stack;
+
+    // A declaration being searched, and its next reference to follow
+    struct Frame
+    {
+        int declaration;
+        size_t next;
+    };
+
+    WorkStack<Frame> frames;
+    std::vector<Group> groups;
+    int discovered = 0;
+
+    auto discover = [&](int declaration) {
+        index[declaration] = lowlink[declaration] = discovered++;
+        stack.push(declaration);
+        frames.push({declaration, 0});
+    };
+
+    for (int root = 0; root < count; ++root)
+    {
+        if (index[root] != -1)
+        {
+            continue;
+        }
+
+        discover(root);
+        while (!frames.empty())
+        {
+            int declaration = frames.top().declaration;
+            size_t next = frames.top().next++;
+
+            if (next < references[declaration].size())
+            {
+                int reference = references[declaration][next];
+                if (index[reference] == -1)
+                {
+                    discover(reference);
+                }
+                else if (component[reference] == -1)
+                {
+                    lowlink[declaration] = std::min(lowlink[declaration], index[reference]);
+                }
+
+                continue;
+            }
+
+            frames.pop();
+            if (!frames.empty())
+            {
+                int parent = frames.top().declaration;
+                lowlink[parent] = std::min(lowlink[parent], lowlink[declaration]);
+            }
+
+            if (lowlink[declaration] != index[declaration])
+            {
+                continue;
+            }
+
+            // Everything above it on the stack is in its group
+            Group group;
+            int member;
+            do
+            {
+                member = stack.pop();
+                component[member] = groups.size();
+                group.members.push_back(member);
+            } while (member != declaration);
+
+            std::sort(group.members.begin(), group.members.end());
+            groups.push_back(std::move(group));
+        }
+    }
+
+    for (size_t i = 0; i < groups.size(); ++i)
+    {
+        Group& group = groups[i];
+
+        std::vector<int> referenced;
+        for (int member : group.members)
+        {
+            for (int reference : references[member])
+            {
+                if (component[reference] != int(i))
+                {
+                    group.imports.push_back(reference);
+                    referenced.push_back(component[reference]);
+                }
+            }
+        }
+
+        std::sort(group.imports.begin(), group.imports.end());
+        group.imports.erase(std::unique(group.imports.begin(), group.imports.end()), group.imports.end());
+
+        std::sort(referenced.begin(), referenced.end());
+        referenced.erase(std::unique(referenced.begin(), referenced.end()), referenced.end());
+
+        for (int other : referenced)
+        {
+            groups[other].dependents.push_back(i);
+        }
+    }
+
+    return groups;
+}
+
+void ModuleAnalyzer::fail(int declaration, const std::string& message)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    // Which groups fail does not depend on timing, so report the same one
+    // every time
+    if (_errorDeclaration == -1 || declaration < _errorDeclaration)
+    {
+        _errorDeclaration = declaration;
+        _error = message;
+    }
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include "ast.hpp"
+#include "thread_pool.hpp"
+#include "types.hpp"
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Type-checks a module (see Parser::parseModule)
+//
+// Declarations are split into binding groups: the strongly connected components
+// of the graph of references between them. Each group is inferred by its own
+// SemanticAnalyzer once the groups it refers to are done, so that independent
+// groups are inferred concurrently. The generalized types of a group are then
+// published, and copied into the analyzer of each group which refers to them.
+//
+// Every group is checked against its own eq and id, so a type which still refers
+// to their monomorphic variables cannot be published, and is an error.
+class ModuleAnalyzer
+{
+public:
+    // Infers the scheme of every declaration, in order. If any group fails, throws
+    // the error of the one with the earliest declaration.
+    //
+    // Waits for the pool to be idle, so must not be called from one of its tasks.
+    std::vector<typ::TypeScheme> infer(ast::Context& module, ThreadPool& pool);
+
+private:
+    struct Group
+    {
+        std::vector<int> members; // in declaration order
+        std::vector<int> imports; // declarations of other groups which members refer to
+        std::vector<int> dependents; // groups which refer to this one
+    };
+
+    // Splits the declarations into groups, each after those it refers to
+    std::vector<Group> group(const std::vector<std::vector<int>>& references);
+
+    void fail(int declaration, const std::string& message);
+
+    // Owns the published types (and so the results of infer)
+    typ::TypeArena _types;
+
+    // Protects _types, and the first error
+    std::mutex _mutex;
+    int _errorDeclaration = -1;
+    std::string _error;
+};
@@ -1,119 +1,248 @@
 #include "parser.hpp"
+#include <stdexcept>
 
 using namespace ast;
 
 Context Parser::parse()
 {
-    _context.setRoot(expression());
+    Expr* root = expression();
+
+    // Text which follows the expression is ignored, unless it is not text the
+    // lexer accepts
+    if (_lexer.peek() == Token::Err)
+    {
+        fail();
+    }
+
+    _context.setRoot(_failed ? nullptr : root);
     return std::move(_context);
 }
 
-Expr* Parser::expression()
+Context Parser::parse(Diagnostics& diagnostics)
 {
-    if (_lexer.peek() == Token::Let)
-    {
-        return letExpr();
-    }
-    else if (_lexer.peek() == Token::Fun)
+    _diagnostics = &diagnostics;
+    return parse();
+}
+
+Context Parser::parseModule()
+{
+    while (_lexer.peek() != Token::Eof)
     {
-        return funExpr();
+        expect(Token::Let);
+
+        Declaration declaration;
+        declaration.name = _context.intern(expect(Token::Ident).lexeme);
+        expect(Token::Equals);
+
+        // The value ends where the next declaration starts
+        declaration.value = expression();
+        _declarations.push(declaration);
     }
-    else
+
+    _context.setDeclarations(_context.makeList(_declarations.data(), _declarations.size()));
+    return std::move(_context);
+}
+
+// Alternates between two phases: descending through the prefixes of nested
+// constructs until a variable is reached, then reducing completed constructs
+// until one of them needs another subexpression
+//
+// Returns nullptr once the parser has failed.
+Expr* Parser::expression()
+{
+    size_t base = _frames.size();
+
+    while (!_failed)
     {
-        Expr* expr = simpleExpr();
+        Expr* expr = nullptr;
 
-        if (_lexer.accept(Token::Lparen))
+        // Descend to the start of the next simple expression
+        while (!expr && !_failed)
         {
-            // Function call: f(e1, e2, ...)
-            std::vector<Expr*> arguments;
-            if (_lexer.peek() != Token::Rparen)
+            if (_lexer.peek() == Token::Let)
             {
-                arguments = expressionList();
+                letPrefix();
             }
+            else if (_lexer.peek() == Token::Fun)
+            {
+                funPrefix();
+            }
+            else if (_lexer.peek() == Token::Ident)
+            {
+                Token name = expect(Token::Ident);
+                SourceRange nameRange = range(name.lexeme);
 
-            _lexer.expect(Token::Rparen);
+                Var* var = Var::create(_context, _context.intern(name.lexeme));
+                expr = callSuffix(at(var, nameRange.begin, nameRange.end));
+            }
+            else // parenthesized expression
+            {
+                expect(Token::Lparen);
+                _frames.push({Frame::Paren});
+            }
+        }
 
-            return Call::create(_context, expr, arguments);
+        // Reduce until some construct needs another subexpression
+        while (expr && _frames.size() > base && !_failed)
+        {
+            Frame& frame = _frames.top();
+
+            switch (frame.kind)
+            {
+                case Frame::LetValue:
+                    expect(Token::In);
+                    frame.kind = Frame::LetBody;
+                    frame.expr = expr;
+                    expr = nullptr;
+                    break;
+
+                case Frame::LetBody:
+                    expr = at(Let::create(_context, frame.name, frame.expr, expr), frame.begin, expr->range.end);
+                    _frames.pop();
+                    break;
+
+                case Frame::FunBody:
+                {
+                    size_t count = _parameters.size() - frame.base;
+                    Span<Symbol> parameters = _context.makeList(_parameters.data() + frame.base, count);
+                    _parameters.truncate(frame.base);
+
+                    expr = at(Fun::create(_context, parameters, expr), frame.begin, expr->range.end);
+                    _frames.pop();
+                    break;
+                }
+
+                // A parenthesized expression is simple, so may be called
+                case Frame::Paren:
+                    expect(Token::Rparen);
+                    _frames.pop();
+                    expr = callSuffix(expr);
+                    break;
+
+                case Frame::CallArgs:
+                    _arguments.push(expr);
+                    if (accept(Token::Comma))
+                    {
+                        expr = nullptr;
+                    }
+                    else
+                    {
+                        uint32_t end = range(expect(Token::Rparen).lexeme).end;
+
+                        size_t count = _arguments.size() - frame.base;
+                        Span<Expr*> arguments = _context.makeList(_arguments.data() + frame.base, count);
+                        _arguments.truncate(frame.base);
+
+                        Call* call = Call::create(_context, frame.expr, arguments);
+                        expr = at(call, frame.expr->range.begin, end);
+                        _frames.pop();
+                    }
+                    break;
+            }
         }
-        else
+
+        if (expr && !_failed)
         {
-            // Just a simple expression
             return expr;
         }
     }
+
+    return nullptr;
 }
 
-// let name = value in body
-Let* Parser::letExpr()
+// let name = (value follows)
+void Parser::letPrefix()
 {
-    _lexer.expect(Token::Let);
-
-    std::string name = _lexer.expect(Token::Ident).lexeme;
+    Frame frame{Frame::LetValue};
+    frame.begin = range(expect(Token::Let).lexeme).begin;
+    frame.name = _context.intern(expect(Token::Ident).lexeme);
 
-    _lexer.expect(Token::Equals);
+    expect(Token::Equals);
 
-    Expr* value = expression();
-
-    _lexer.expect(Token::In);
-
-    Expr* body = expression();
-
-    return Let::create(_context, name, value, body);
+    _frames.push(frame);
 }
 
-// fun x, y, ... -> body
-Fun* Parser::funExpr()
+// fun x, y, ... -> (body follows)
+void Parser::funPrefix()
 {
-    _lexer.expect(Token::Fun);
+    Frame frame{Frame::FunBody};
+    frame.begin = range(expect(Token::Fun).lexeme).begin;
 
     // Always at least one parameter
-    std::vector<std::string> parameters;
-    parameters.push_back(_lexer.expect(Token::Ident).lexeme);
+    frame.base = _parameters.size();
+    _parameters.push(_context.intern(expect(Token::Ident).lexeme));
 
     // And maybe more, separated by commas
-    while (_lexer.accept(Token::Comma))
+    while (!_failed && accept(Token::Comma))
     {
-        parameters.push_back(_lexer.expect(Token::Ident).lexeme);
+        _parameters.push(_context.intern(expect(Token::Ident).lexeme));
     }
 
-    _lexer.expect(Token::Arrow);
+    expect(Token::Arrow);
 
-    Expr* body = expression();
-
-    return Fun::create(_context, parameters, body);
+    _frames.push(frame);
 }
 
-// identifier or parenthesized expression
-Expr* Parser::simpleExpr()
+// Parses an optional call of the simple expression expr: f(e1, e2, ...)
+//
+// Returns nullptr if the call has arguments, which are parsed (and the call
+// completed) by expression().
+Expr* Parser::callSuffix(Expr* expr)
 {
-    if (_lexer.peek() == Token::Ident)
+    if (!accept(Token::Lparen))
     {
-        std::string name = _lexer.expect(Token::Ident).lexeme;
-        return Var::create(_context, name);
+        // Just a simple expression
+        return expr;
     }
-    else // parenthesized expression
+
+    SourceRange close = range(_lexer.current().lexeme);
+    if (accept(Token::Rparen))
     {
-        _lexer.expect(Token::Lparen);
+        return at(Call::create(_context, expr, Span<Expr*>()), expr->range.begin, close.end);
+    }
 
-        Expr* expr = expression();
+    Frame frame{Frame::CallArgs};
+    frame.expr = expr;
+    frame.base = _arguments.size();
+    _frames.push(frame);
 
-        _lexer.expect(Token::Rparen);
+    return nullptr;
+}
 
-        return expr;
+Token Parser::expect(Token::TokenType type)
+{
+    Token token = _lexer.current();
+    if (token.type == type)
+    {
+        _lexer.accept(type);
     }
+    else
+    {
+        fail();
+    }
+
+    return token;
 }
 
-// One or more expression separated by commas
-std::vector<Expr*> Parser::expressionList()
+void Parser::fail()
 {
-    std::vector<Expr*> result;
+    const Token& token = _lexer.current();
+    const char* message = (token.type == Token::Err) ? "lexer error" : "syntax error";
 
-    result.push_back(expression());
+    if (!_diagnostics)
+    {
+        throw std::runtime_error(message);
+    }
 
-    while (_lexer.accept(Token::Comma))
+    if (!_failed)
     {
-        result.push_back(expression());
+        _diagnostics->report(range(token.lexeme), message);
+        _failed = true;
     }
+}
 
-    return result;
+SourceRange Parser::range(std::string_view lexeme) const
+{
+    uint32_t begin = lexeme.data() - _source;
+    return {begin, uint32_t(begin + lexeme.size())};
 }
@@ -1,23 +1,93 @@
 #pragma once
 #include "ast.hpp"
+#include "diagnostics.hpp"
 #include "lexer.hpp"
+#include "work_stack.hpp"
 
+// The program text must outlive the parser
+//
+// Nested constructs are tracked on an explicit stack rather than by recursive
+// descent, so that deeply nested programs cannot overflow the native stack.
 class Parser
 {
 public:
-    Parser(const std::string& program)
-    : _lexer(program)
+    Parser(std::string_view program)
+    : _source(program.data()), _lexer(program)
     {}
 
+    // A program is a single expression. Throws on the first syntax error.
     ast::Context parse();
 
+    // Reports the first syntax error to diagnostics instead, and then stops,
+    // returning a context without a root
+    ast::Context parse(Diagnostics& diagnostics);
+
+    // A module is a sequence of top-level declarations, let name = value,
+    // without bodies. Unlike a let, each declaration is visible throughout the
+    // module, including in its own value.
+    ast::Context parseModule();
+
 private:
+    // A construct whose remaining subexpressions have yet to be parsed
+    struct Frame
+    {
+        enum Kind
+        {
+            LetValue, // let name = . in body
+            LetBody,  // let name = value in .
+            FunBody,  // fun x, y, ... -> .
+            Paren,    // ( . )
+            CallArgs, // f(e1, ..., .)
+        };
+
+        Kind kind;
+        ast::Symbol name;
+        ast::Expr* expr = nullptr; // let value or called function
+
+        // Offset of the let or fun keyword
+        uint32_t begin = 0;
+
+        // Start of the parameters or arguments parsed so far
+        size_t base = 0;
+    };
+
     ast::Expr* expression();
-    ast::Let* letExpr();
-    ast::Fun* funExpr();
-    ast::Expr* simpleExpr();
-    std::vector<ast::Expr*> expressionList();
+    void letPrefix();
+    void funPrefix();
+    ast::Expr* callSuffix(ast::Expr* expr);
+
+    // As in Lexer, but failing through fail()
+    Token expect(Token::TokenType type);
+    bool accept(Token::TokenType type) { return _lexer.accept(type); }
+
+    // Reports the current token as unexpected, or throws if there is nowhere
+    // to report it. Once failed, the parser only unwinds.
+    void fail();
+
+    SourceRange range(std::string_view lexeme) const;
+
+    // The node, with its range set
+    template <typename T>
+    T* at(T* node, uint32_t begin, uint32_t end)
+    {
+        node->range = {begin, end};
+        return node;
+    }
+
+    WorkStack<Frame> _frames;
+
+    // Parameters and arguments of the open constructs, innermost last. Each is
+    // copied into the context in one piece once it is complete.
+    WorkStack<ast::Symbol> _parameters;
+    WorkStack<ast::Expr*> _arguments;
+
+    WorkStack<ast::Declaration> _declarations;
 
     ast::Context _context;
+
+    const char* _source;
     Lexer _lexer;
+
+    Diagnostics* _diagnostics = nullptr;
+    bool _failed = false;
 };
@@ -0,0 +1,42 @@
+#include "prelude.hpp"
+#include "stats.hpp"
+
+using typ::Type;
+
+Prelude::Prelude()
+{
+    // Not counted against whichever analyzer happens to be first
+    typ::Stats stats;
+    typ::Stats::Scope statsScope(stats);
+
+    Type* Int = types.makeConstant("Int");
+    env.insert("zero", Int);
+    env.insert("one", Int);
+
+    Type* Bool = types.makeConstant("Bool");
+    env.insert("true", Bool);
+    env.insert("false", Bool);
+
+    env.insert("nonzero", types.makeArrow({Int}, Bool));
+    env.insert("succ", types.makeArrow({Int}, Int));
+    env.insert("add", types.makeArrow({Int, Int}, Int));
+}
+
+const Prelude& prelude()
+{
+    static const Prelude prelude;
+    return prelude;
+}
+
+void bindMonomorphic(typ::TypeArena& types, typ::TypeEnvironment& env)
+{
+    Type* Bool = types.makeConstant("Bool");
+
+    // eq
+    Type* T = types.makeUnbound(0);
+    env.insert(monomorphicNames[0], types.makeArrow({T, T}, Bool));
+
+    // id
+    Type* S = types.makeUnbound(0);
+    env.insert(monomorphicNames[1], types.makeArrow({S}, S));
+}
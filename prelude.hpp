@@ -0,0 +1,24 @@
+#pragma once
+#include "type_env.hpp"
+#include "types.hpp"
+#include <string_view>
+
+// Types and values available to every program. They are built once, and never
+// change afterwards, so every analyzer (on any thread) shares them.
+struct Prelude
+{
+    typ::TypeArena types;
+    typ::TypeEnvironment env;
+
+    Prelude();
+};
+
+const Prelude& prelude();
+
+// Binds eq and id, whose types are monomorphic: each analyzer has its own
+// variables for them, which the programs it checks may fix once. They cannot
+// be shared, so are bound on top of the prelude.
+void bindMonomorphic(typ::TypeArena& types, typ::TypeEnvironment& env);
+
+// The names which bindMonomorphic binds, in order
+inline constexpr std::string_view monomorphicNames[] = {"eq", "id"};
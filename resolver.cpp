@@ -0,0 +1,159 @@
+#include "resolver.hpp"
+#include <stdexcept>
+#include <string>
+
+Resolver::Resolver(const typ::TypeEnvironment& env)
+{
+    for (int slot = 0; slot < env.size(); ++slot)
+    {
+        bind(symbol(env.name(slot)));
+    }
+
+    _initialSize = env.size();
+}
+
+void Resolver::resolve(ast::Expr* node)
+{
+    descend(node);
+    while (!_frames.empty())
+    {
+        Frame frame = _frames.pop();
+        _state = frame.state;
+        frame.node->accept(this);
+    }
+}
+
+void Resolver::resolve(ast::Expr* node, std::vector<int>& references)
+{
+    _references = &references;
+
+    try
+    {
+        resolve(node);
+    }
+    catch (...)
+    {
+        _references = nullptr;
+        throw;
+    }
+
+    _references = nullptr;
+}
+
+int Resolver::symbol(std::string_view name)
+{
+    auto i = _symbols.find(name);
+    if (i == _symbols.end())
+    {
+        i = _symbols.emplace(name, _slots.size()).first;
+        _slots.emplace_back();
+    }
+
+    return i->second;
+}
+
+int Resolver::symbol(ast::Symbol name)
+{
+    if (name.id() >= _astSymbols.size())
+    {
+        _astSymbols.resize(name.id() + 1, -1);
+    }
+
+    int& symbol = _astSymbols[name.id()];
+    if (symbol == -1)
+    {
+        symbol = this->symbol(name.str());
+    }
+
+    return symbol;
+}
+
+void Resolver::bind(int symbol)
+{
+    _slots[symbol].push_back(_bound.size());
+    _bound.push_back(symbol);
+}
+
+// Removes all bindings beyond the first size slots
+void Resolver::unbind(size_t size)
+{
+    while (_bound.size() > size)
+    {
+        _slots[_bound.back()].pop_back();
+        _bound.pop_back();
+    }
+}
+
+void Resolver::visit(ast::Var* node)
+{
+    const std::vector<int>& slots = _slots[symbol(node->name)];
+    if (slots.empty())
+    {
+        std::string message = "undefined variable: " + std::string(node->name.str());
+        if (!_diagnostics)
+        {
+            throw std::runtime_error(message);
+        }
+
+        _diagnostics->report(node->range, std::move(message));
+        node->slot = -1;
+        return;
+    }
+
+    node->slot = slots.back();
+
+    if (_references && node->slot < _initialSize)
+    {
+        _references->push_back(node->slot);
+    }
+}
+
+void Resolver::visit(ast::Call* node)
+{
+    // Resolve the function, then each argument in turn
+    if (size_t(_state) <= node->arguments.size())
+    {
+        suspend(node, _state + 1);
+        descend(_state == 0 ? node->function : node->arguments[_state - 1]);
+    }
+}
+
+void Resolver::visit(ast::Fun* node)
+{
+    if (_state == 0)
+    {
+        for (ast::Symbol param : node->parameters)
+        {
+            bind(symbol(param));
+        }
+
+        suspend(node, 1);
+        descend(node->body);
+    }
+    else
+    {
+        unbind(_bound.size() - node->parameters.size());
+    }
+}
+
+void Resolver::visit(ast::Let* node)
+{
+    switch (_state)
+    {
+        // The bound name is not visible in its own definition
+        case 0:
+            suspend(node, 1);
+            descend(node->value);
+            break;
+
+        case 1:
+            bind(symbol(node->name));
+            suspend(node, 2);
+            descend(node->body);
+            break;
+
+        case 2:
+            unbind(_bound.size() - 1);
+            break;
+    }
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include "ast.hpp"
+#include "diagnostics.hpp"
+#include "type_env.hpp"
+#include "work_stack.hpp"
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Name resolution: binds every variable reference to the environment slot of
+// its definition ahead of type inference, so that the type checker never
+// has to search for identifiers
+//
+// Slots are assigned in exactly the order in which SemanticAnalyzer pushes
+// bindings onto its environment: function parameters left-to-right, then the
+// name bound by a let (after its value has been checked).
+class Resolver : public ast::Visitor
+{
+public:
+    // The identifiers already bound in env are visible to the program
+    Resolver(const typ::TypeEnvironment& env);
+
+    // Throws if the program references an undefined variable
+    void resolve(ast::Expr* node);
+
+    // Report undefined variables to diagnostics rather than throwing, leaving
+    // their slots at -1. The diagnostics must outlive the resolver.
+    void setDiagnostics(Diagnostics* diagnostics) { _diagnostics = diagnostics; }
+
+    // Also appends to references the slot of every reference to a binding of
+    // the initial environment (there may be duplicates)
+    void resolve(ast::Expr* node, std::vector<int>& references);
+
+    void visit(ast::Var* node) override;
+    void visit(ast::Call* node) override;
+    void visit(ast::Fun* node) override;
+    void visit(ast::Let* node) override;
+
+private:
+    int symbol(std::string_view name);
+    int symbol(ast::Symbol name);
+
+    void bind(int symbol);
+    void unbind(size_t size);
+
+    // As in SemanticAnalyzer, nodes are visited from an explicit stack: a
+    // visit suspends itself (to be revisited at the given state) before
+    // descending into a child
+    void suspend(ast::Expr* node, int state) { _frames.push({node, state}); }
+    void descend(ast::Expr* child) { _frames.push({child, 0}); }
+
+    struct Frame
+    {
+        ast::Expr* node;
+        int state;
+    };
+
+    WorkStack<Frame> _frames;
+    int _state = 0;
+
+    // Identifiers are interned into dense symbol ids. Those of the program
+    // are looked up by name only once, then by the id of their ast::Symbol.
+    std::unordered_map<std::string_view, int> _symbols;
+    std::vector<int> _astSymbols;
+
+    // For each symbol, the slots which currently bind it (innermost last)
+    std::vector<std::vector<int>> _slots;
+
+    // Symbol bound in each slot
+    std::vector<int> _bound;
+
+    int _initialSize = 0;
+    std::vector<int>* _references = nullptr;
+
+    Diagnostics* _diagnostics = nullptr;
+};
@@ -0,0 +1,117 @@
+#include "scan.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+const char* skipSpaceScalar(const char* p, const char* end)
+{
+    while (p != end && isSpace(*p))
+    {
+        ++p;
+    }
+
+    return p;
+}
+
+const char* skipIdentifierScalar(const char* p, const char* end)
+{
+    while (p != end && isIdentifier(*p))
+    {
+        ++p;
+    }
+
+    return p;
+}
+
+#ifdef __SSE2__
+
+// Bytes tested one at a time before the first block. Enough for the single
+// spaces between tokens, without delaying longer runs.
+static const ptrdiff_t kPrefix = 2;
+
+// Unsigned comparisons are not available for bytes, but x <= bound exactly
+// when min(x, bound) == x
+static inline __m128i lessOrEqual(__m128i x, __m128i bound)
+{
+    return _mm_cmpeq_epi8(_mm_min_epu8(x, bound), x);
+}
+
+// Skips whole blocks for as long as every byte is in the class, then finds the
+// first which is not in the last block. The remaining bytes are left to the
+// scalar version.
+template <typename IsMember, typename Classify>
+static const char* skipBlocks(const char* p, const char* end, IsMember isMember, Classify classify)
+{
+    for (const char* prefix = p + std::min<ptrdiff_t>(end - p, kPrefix); p != prefix; ++p)
+    {
+        if (!isMember(*p))
+        {
+            return p;
+        }
+    }
+
+    while (end - p >= 16)
+    {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        uint32_t outside = ~_mm_movemask_epi8(classify(block)) & 0xffff;
+        if (outside)
+        {
+            return p + __builtin_ctz(outside);
+        }
+
+        p += 16;
+    }
+
+    return p;
+}
+
+const char* skipSpace(const char* p, const char* end)
+{
+    // ' ', or '\t' to '\r'
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i range = _mm_set1_epi8('\r' - '\t');
+
+    p = skipBlocks(p, end, isSpace, [&](__m128i block) {
+        return _mm_or_si128(_mm_cmpeq_epi8(block, space), lessOrEqual(_mm_sub_epi8(block, tab), range));
+    });
+
+    return skipSpaceScalar(p, end);
+}
+
+const char* skipIdentifier(const char* p, const char* end)
+{
+    // '_', a letter in either case, or a digit
+    const __m128i underscore = _mm_set1_epi8('_');
+    const __m128i lower = _mm_set1_epi8(0x20);
+    const __m128i a = _mm_set1_epi8('a');
+    const __m128i letters = _mm_set1_epi8('z' - 'a');
+    const __m128i zero = _mm_set1_epi8('0');
+    const __m128i digits = _mm_set1_epi8(9);
+
+    p = skipBlocks(p, end, isIdentifier, [&](__m128i block) {
+        __m128i letter = lessOrEqual(_mm_sub_epi8(_mm_or_si128(block, lower), a), letters);
+        __m128i digit = lessOrEqual(_mm_sub_epi8(block, zero), digits);
+        return _mm_or_si128(_mm_or_si128(letter, digit), _mm_cmpeq_epi8(block, underscore));
+    });
+
+    return skipIdentifierScalar(p, end);
+}
+
+#else
+
+const char* skipSpace(const char* p, const char* end)
+{
+    return skipSpaceScalar(p, end);
+}
+
+const char* skipIdentifier(const char* p, const char* end)
+{
+    return skipIdentifierScalar(p, end);
+}
+
+#endif
@@ -0,0 +1,29 @@
+#pragma once
+
+// Finds the end of a run of whitespace (as in Ragel's space: ' ', '\t', '\n',
+// '\v', '\f', '\r') or of identifier characters ([_a-zA-Z0-9]) starting at p.
+// Both return the first byte which is not part of the run, or end.
+//
+// Bytes are classified 16 at a time with SSE2 where it is available (always,
+// on x86-64), and one at a time otherwise and for the last few bytes.
+const char* skipSpace(const char* p, const char* end);
+const char* skipIdentifier(const char* p, const char* end);
+
+// The byte-at-a-time versions, for comparison
+const char* skipSpaceScalar(const char* p, const char* end);
+const char* skipIdentifierScalar(const char* p, const char* end);
+
+inline bool isSpace(char c)
+{
+    return c == ' ' || (unsigned char)(c - '\t') <= '\r' - '\t';
+}
+
+inline bool isIdentifierStart(char c)
+{
+    return c == '_' || (unsigned char)((c | 0x20) - 'a') <= 'z' - 'a';
+}
+
+inline bool isIdentifier(char c)
+{
+    return isIdentifierStart(c) || (unsigned char)(c - '0') <= 9;
+}
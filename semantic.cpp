@@ -1,102 +1,396 @@
 #include "semantic.hpp"
+#include "fingerprint.hpp"
+#include "prelude.hpp"
+#include "resolver.hpp"
+#include <algorithm>
+#include <stdexcept>
 
+using typ::Arrow;
 using typ::Type;
 
-#define RETURN(x) \
-    _type = (x); \
-    return
-
 SemanticAnalyzer::SemanticAnalyzer()
+: _env(&prelude().env), _types(&prelude().types)
+{
+    bindMonomorphic(_types, _env);
+}
+
+Type* SemanticAnalyzer::infer(ast::Expr* node)
+{
+#ifdef HM_STATS
+    typ::Stats::Scope statsScope(_stats);
+#endif
+
+    Resolver resolver(_env);
+    resolver.resolve(node);
+
+    if (_cache)
+    {
+        Fingerprinter fingerprinter(_env);
+        fingerprinter.fingerprint(node);
+    }
+
+    return check(node);
+}
+
+Type* SemanticAnalyzer::infer(ast::Expr* node, Diagnostics& diagnostics)
+{
+#ifdef HM_STATS
+    typ::Stats::Scope statsScope(_stats);
+#endif
+
+    _diagnostics = &diagnostics;
+    _failed = false;
+    size_t reported = diagnostics.size();
+
+    Resolver resolver(_env);
+    resolver.setDiagnostics(&diagnostics);
+    resolver.resolve(node);
+
+    // Fingerprints need every reference resolved
+    _failed = diagnostics.size() != reported;
+    if (_cache && !_failed)
+    {
+        Fingerprinter fingerprinter(_env);
+        fingerprinter.fingerprint(node);
+    }
+
+    Type* type = check(node);
+    _diagnostics = nullptr;
+
+    // Names are resolved before anything is checked, so put all in order
+    diagnostics.sort(reported);
+    return diagnostics.size() == reported ? type : nullptr;
+}
+
+void SemanticAnalyzer::import(std::string_view name, typ::TypeScheme scheme)
+{
+    _env.insert(name, typ::TypeScheme{copy(_types, scheme.type), scheme.quantifiers});
+}
+
+std::vector<typ::TypeScheme> SemanticAnalyzer::inferGroup(const std::vector<ast::Declaration>& group)
 {
-    // Boostrap with some basic types and values
-    Type* Int = new typ::Constant("Int");
-    _env.insert("zero", Int);
-    _env.insert("one", Int);
+#ifdef HM_STATS
+    typ::Stats::Scope statsScope(_stats);
+#endif
+
+    int level = _level;
+    size_t depth = _env.depth();
+
+    try
+    {
+        // Each declaration is bound to a variable while the values are
+        // checked, as if they were all the values of a single let
+        _env.enterScope();
+        _level += 1;
+
+        std::vector<Type*> types;
+        for (const ast::Declaration& declaration : group)
+        {
+            Type* type = _types.makeUnbound(_level);
+            _env.insert(declaration.name.str(), type);
+            types.push_back(type);
+        }
+
+        Resolver resolver(_env);
+        for (size_t i = 0; i < group.size(); ++i)
+        {
+            resolver.resolve(group[i].value);
+            Type* type = check(group[i].value);
+
+            _types.setOrigin(group[i].value);
+            if (!unify(_types, types[i], type))
+            {
+                throw std::runtime_error(checkCycles(_types) ? "unification error" : "infinite type");
+            }
+        }
+
+        if (!checkCycles(_types))
+        {
+            throw std::runtime_error("infinite type");
+        }
+
+        _level -= 1;
+
+        std::vector<typ::TypeScheme> schemes;
+        for (Type* type : types)
+        {
+            HM_COUNT(generalizations, 1);
+            schemes.push_back(generalize(_types, type, _level));
+            if (!schemes.back().type)
+            {
+                throw std::runtime_error("infinite type");
+            }
+        }
+
+        _env.exitScope();
+        return schemes;
+    }
+    catch (...)
+    {
+        recover(level, depth);
+        throw;
+    }
+}
 
-    Type* Bool = new typ::Constant("Bool");
-    _env.insert("true", Bool);
-    _env.insert("false", Bool);
+Type* SemanticAnalyzer::check(ast::Expr* node)
+{
+    int level = _level;
+    size_t depth = _env.depth();
+    descend(node);
 
-    _env.insert("nonzero", new typ::Arrow({Int}, Bool));
-    _env.insert("succ", new typ::Arrow({Int}, Int));
-    _env.insert("add", new typ::Arrow({Int, Int}, Int));
+    try
+    {
+        while (!_frames.empty())
+        {
+            Frame frame = _frames.pop();
+            _state = frame.state;
+            frame.node->accept(this);
+        }
 
-    Type* T = instantiate(typ::Var::makeUnbound(_level), _level);
-    _env.insert("eq", new typ::Arrow({T, T}, Bool));
+        // Binding never searches for infinite types, so search them all at once
+        reportCycles(node);
+    }
+    catch (...)
+    {
+        // Leave nothing behind for the next program
+        recover(level, depth);
+        throw;
+    }
 
-    Type* S = instantiate(typ::Var::makeUnbound(_level), _level);
-    _env.insert("id", new typ::Arrow({S}, S));
+    return _results.pop();
+}
+
+void SemanticAnalyzer::recover(int level, size_t depth)
+{
+    _frames.clear();
+    _results.clear();
+
+    while (_env.depth() > depth)
+    {
+        _env.exitScope();
+    }
+
+    _level = level;
+    _types.discardDeferred();
 }
 
 void SemanticAnalyzer::visit(ast::Var* node)
 {
-    Type* type = _env.lookup(node->name);
-    if (!type)
+    // Undefined variables have already been reported by the resolver
+    if (node->slot == -1)
+    {
+        _results.push(_types.makeUnbound(_level));
+        return;
+    }
+
+    typ::TypeScheme scheme = _env.lookup(node->slot);
+
+    // Monomorphic bindings (such as function parameters) are used as they are
+    if (scheme.quantifiers == 0)
     {
-        throw std::runtime_error("undefined variable: " + node->name);
+        _results.push(scheme.type);
+        return;
     }
 
-    RETURN(instantiate(type, _level));
+    HM_COUNT(instantiations, 1);
+    _results.push(instantiate(_types, scheme, _level));
 }
 
 void SemanticAnalyzer::visit(ast::Call* node)
 {
-    Type* fnType = infer(node->function);
+    // Check the function, then each argument in turn
+    size_t count = node->arguments.size();
+    if (size_t(_state) <= count)
+    {
+        suspend(node, _state + 1);
+        descend(_state == 0 ? node->function : node->arguments[_state - 1]);
+        return;
+    }
+
+    // The results are the function's type followed by the argument types
+    size_t base = _results.size() - count - 1;
+    _types.setOrigin(node);
+    Type* fnType = _results[base]->root();
+    Type** argTypes = _results.data() + base + 1;
+
+    Type* outType = nullptr;
+    if (fnType->tag() == typ::kArrow)
+    {
+        // Usually the function is already known to be an arrow, so its
+        // inputs can be unified with the arguments in place
+        Arrow* arrow = static_cast<Arrow*>(fnType);
+        bool unified = arrow->inputs.size() == count;
+        for (size_t i = 0; i < count && unified; ++i)
+        {
+            unified = unify(_types, arrow->inputs[i], argTypes[i]);
+        }
 
-    std::vector<Type*> argTypes;
-    for (auto* arg : node->arguments)
+        outType = unified ? arrow->output : nullptr;
+    }
+    else
     {
-        argTypes.push_back(infer(arg));
+        // Otherwise solve for the return type of the function call
+        Span<Type*> inputs = _types.makeInputs(count);
+        std::copy(argTypes, argTypes + count, inputs.begin());
+
+        outType = _types.makeUnbound(_level);
+        if (!unify(_types, fnType, _types.makeArrow(inputs, outType)))
+        {
+            outType = nullptr;
+        }
     }
 
-    // Solve for the return type of the function call
-    Type* outType = typ::Var::makeUnbound(_level);
-    Type* expectedType = new typ::Arrow(argTypes, outType);
-    if (!unify(fnType, expectedType))
+    // A failed call could have any type. It may have failed on an infinite
+    // type made earlier, which is reported where it was made instead.
+    if (!outType)
     {
-        throw std::runtime_error("unification error");
+        if (reportCycles(node))
+        {
+            error(node, "unification error");
+        }
+
+        outType = _types.makeUnbound(_level);
     }
 
-    RETURN(outType);
+    _results.truncate(base);
+    _results.push(outType);
 }
 
 void SemanticAnalyzer::visit(ast::Fun* node)
 {
-    // Function definitions define a new scope
-    _env.enterScope();
+    size_t count = node->parameters.size();
+
+    if (_state == 0)
+    {
+        // Function definitions define a new scope
+        _env.enterScope();
 
-    // Function parameters start out arbitrary, are constrained by
-    // their usage in the function body
-    std::vector<Type*> paramTypes;
-    for (auto& param : node->parameters)
+        // Function parameters start out arbitrary, are constrained by
+        // their usage in the function body. Their types wait on the results
+        // stack until the body has been checked.
+        for (ast::Symbol param : node->parameters)
+        {
+            Type* paramType = _types.makeUnbound(_level);
+            _env.insert(param.str(), paramType);
+            _results.push(paramType);
+        }
+
+        suspend(node, 1);
+        descend(node->body);
+        return;
+    }
+
+    Type* bodyType = _results.pop();
+
+    size_t base = _results.size() - count;
+    Span<Type*> paramTypes = _types.makeInputs(count);
+    for (size_t i = 0; i < count; ++i)
     {
-        Type* paramType = typ::Var::makeUnbound(_level);
-        paramTypes.push_back(paramType);
-        _env.insert(param, paramType);
+        paramTypes[i] = _results[base + i];
     }
 
-    Type* bodyType = infer(node->body);
+    _results.truncate(base);
 
     _env.exitScope();
 
-    RETURN(new typ::Arrow(paramTypes, bodyType));
+    _results.push(_types.makeArrow(paramTypes, bodyType));
 }
 
 void SemanticAnalyzer::visit(ast::Let* node)
 {
-    // Keep track of the level of let-nesting in order to optimize generalization
-    _level += 1;
-    Type* valueType = infer(node->value);
-    _level -= 1;
+    switch (_state)
+    {
+        case 0:
+        {
+            // An unchanged value needs no checking at all
+            if (_cache && node->fingerprint)
+            {
+                typ::TypeScheme cached = _cache->find(node->fingerprint, node->valueSize, _types);
+                if (cached.type)
+                {
+                    HM_COUNT(lets, 1);
+                    bindLet(node, cached);
+                    break;
+                }
+            }
+
+            // Keep track of the level of let-nesting in order to optimize
+            // generalization
+            _level += 1;
 
-    // Let-generalization
-    Type* genValueType = generalize(valueType, _level);
+            suspend(node, 1);
+            descend(node->value);
+            break;
+        }
 
+        case 1:
+        {
+            _level -= 1;
+            Type* valueType = _results.pop();
+
+            // Let-generalization
+            HM_COUNT(lets, 1);
+            HM_COUNT(generalizations, 1);
+            typ::TypeScheme valueScheme = generalize(_types, valueType, _level);
+
+            // Nor could a value of infinite type, which is reported where it
+            // was made (rather than again by the final check). Each use of it
+            // gets a fresh variable, so that uses do not constrain each other.
+            if (!valueScheme.type)
+            {
+                if (reportCycles(node))
+                {
+                    error(node, "infinite type");
+                }
+
+                valueScheme = {_types.makeGeneric(0), 1};
+            }
+
+            if (_cache && node->fingerprint && !_failed && isClosed(valueScheme.type))
+            {
+                _cache->insert(node->fingerprint, valueScheme, node->valueSize);
+            }
+
+            bindLet(node, valueScheme);
+            break;
+        }
+
+        // The type of the body is the type of the let
+        case 2:
+            _env.exitScope();
+            break;
+    }
+}
+
+void SemanticAnalyzer::error(const ast::Expr* node, const char* message)
+{
+    if (!_diagnostics)
+    {
+        throw std::runtime_error(message);
+    }
+
+    _diagnostics->report(node->range, message);
+    _failed = true;
+}
+
+bool SemanticAnalyzer::reportCycles(const ast::Expr* node)
+{
+    const void* origin = nullptr;
+    if (checkCycles(_types, &origin))
+    {
+        return true;
+    }
+
+    error(origin ? static_cast<const ast::Expr*>(origin) : node, "infinite type");
+    return false;
+}
+
+void SemanticAnalyzer::bindLet(ast::Let* node, typ::TypeScheme valueScheme)
+{
     // The body of a let statement defines a new scope
     _env.enterScope();
-    _env.insert(node->name, genValueType);
-    Type* bodyType = infer(node->body);
-    _env.exitScope();
+    _env.insert(node->name.str(), valueScheme);
 
-    RETURN(bodyType);
+    suspend(node, 2);
+    descend(node->body);
 }
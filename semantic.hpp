@@ -1,17 +1,52 @@
 #pragma once
 #include "ast.hpp"
+#include "diagnostics.hpp"
+#include "stats.hpp"
+#include "type_cache.hpp"
 #include "type_env.hpp"
+#include "work_stack.hpp"
+#include <string_view>
+#include <vector>
 
 class SemanticAnalyzer : public ast::Visitor
 {
 public:
+    // Starts from the shared prelude, without copying it, and binds its own
+    // eq and id (see bindMonomorphic)
     SemanticAnalyzer();
 
-    typ::Type* infer(ast::Expr* node)
-    {
-        node->accept(this);
-        return _type;
-    }
+    // Resolves names in the given program, then infers its type. Throws on the
+    // first error.
+    typ::Type* infer(ast::Expr* node);
+
+    // Reports every error to diagnostics instead, and returns nullptr if there
+    // were any. After an undefined variable, or a call or let which fails to
+    // check, checking goes on as if its type were a fresh variable.
+    typ::Type* infer(ast::Expr* node, Diagnostics& diagnostics);
+
+    // Binds a closed scheme from another analysis (see typ::copy), to be
+    // visible to the declarations checked by inferGroup
+    void import(std::string_view name, typ::TypeScheme scheme);
+
+    // Infers the types of a group of module declarations, which may refer to
+    // each other and to everything imported. Within the group they are
+    // monomorphic, and are only generalized together once all are checked.
+    // Returns their schemes, in order.
+    std::vector<typ::TypeScheme> inferGroup(const std::vector<ast::Declaration>& group);
+
+    // Bindings visible to the next program or group: the prelude and imports
+    const typ::TypeEnvironment& environment() const { return _env; }
+
+    // Owns every type created by this analyzer so far
+    const typ::TypeArena& types() const { return _types; }
+
+    // Reuse the types of unchanged let-bound values from the cache, and add
+    // those which are inferred. The cache must outlive the analyzer.
+    void setCache(typ::TypeCache* cache) { _cache = cache; }
+
+    // Counters accumulated by this analyzer so far. Always zero unless built
+    // with HM_STATS.
+    const typ::Stats& stats() const { return _stats; }
 
     void visit(ast::Var* node) override;
     void visit(ast::Call* node) override;
@@ -19,9 +54,56 @@ public:
     void visit(ast::Let* node) override;
 
 private:
-    // For most recently-checked AST node
-    typ::Type* _type;
+    // Checks the program with an explicit stack rather than recursion, so that
+    // deeply nested programs cannot overflow the native stack
+    typ::Type* check(ast::Expr* node);
+
+    // Each visit handles one step of a node. To check a child, it suspends
+    // itself (to be revisited at the given state) and then descends.
+    void suspend(ast::Expr* node, int state) { _frames.push({node, state}); }
+    void descend(ast::Expr* child) { _frames.push({child, 0}); }
+
+    // Binds the (generalized) value of a let, then checks its body
+    void bindLet(ast::Let* node, typ::TypeScheme valueScheme);
+
+    // Undoes whatever a check which threw left behind: the scopes it opened,
+    // its level, and the work deferred on its types
+    void recover(int level, size_t depth);
+
+    // Reports an error in the node, or throws if there is nowhere to report it
+    void error(const ast::Expr* node, const char* message);
+
+    // Searches the types bound since the last search for an infinite type, and
+    // reports it at the call which made it (or else at the given node).
+    // Returns false if there was one.
+    bool reportCycles(const ast::Expr* node);
+
+    struct Frame
+    {
+        ast::Expr* node;
+        int state;
+    };
+
+    WorkStack<Frame> _frames;
+
+    // State of the node currently being visited
+    int _state = 0;
+
+    // Types of the checked nodes whose parents have yet to consume them
+    WorkStack<typ::Type*> _results;
 
     int _level = 0;
     typ::TypeEnvironment _env;
+
+    // Owns every type created by this analyzer (including the result of infer)
+    typ::TypeArena _types;
+
+    typ::TypeCache* _cache = nullptr;
+
+    // Where errors are reported, and whether the current program has any. The
+    // types of programs with errors are never cached.
+    Diagnostics* _diagnostics = nullptr;
+    bool _failed = false;
+
+    typ::Stats _stats;
 };
@@ -0,0 +1,307 @@
+#include "solver.hpp"
+#include "prelude.hpp"
+#include "resolver.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+using typ::Arrow;
+using typ::Type;
+using typ::Var;
+
+ConstraintSolver::ConstraintSolver()
+: _env(&prelude().env), _types(&prelude().types)
+{
+    bindMonomorphic(_types, _env);
+}
+
+Type* ConstraintSolver::infer(ast::Expr* node)
+{
+    Resolver resolver(_env);
+    resolver.resolve(node);
+
+    try
+    {
+        return check(node, false);
+    }
+    catch (const std::runtime_error&)
+    {
+        // Calls are solved out of order, so the error met first may not be the
+        // one which SemanticAnalyzer reports. Errors are rare enough to find
+        // that one by solving the program again, in order.
+        return check(node, true);
+    }
+}
+
+Type* ConstraintSolver::check(ast::Expr* node, bool inOrder)
+{
+    _constraints.clear();
+    _arguments.clear();
+    _schemes.clear();
+
+    try
+    {
+        Type* type = generate(node);
+        solve(inOrder);
+        return type;
+    }
+    catch (...)
+    {
+        // Leave nothing behind for the next program
+        _frames.clear();
+        _results.clear();
+        _bindings.clear();
+        _types.discardDeferred();
+        throw;
+    }
+}
+
+Type* ConstraintSolver::generate(ast::Expr* node)
+{
+    // Generation cannot fail, so nothing is left behind for the next program
+    descend(node);
+    while (!_frames.empty())
+    {
+        Frame frame = _frames.pop();
+        _state = frame.state;
+        frame.node->accept(this);
+    }
+
+    return _results.pop();
+}
+
+void ConstraintSolver::solve(bool inOrder)
+{
+    size_t begin = 0;
+    while (begin < _constraints.size())
+    {
+        size_t end = begin;
+        while (end < _constraints.size() && _constraints[end].kind != Constraint::Generalize)
+        {
+            ++end;
+        }
+
+        solveBatch(begin, end, inOrder);
+        if (end == _constraints.size())
+        {
+            break;
+        }
+
+        // Every constraint on the value has now been solved
+        const Constraint& constraint = _constraints[end];
+        typ::TypeScheme scheme = generalize(_types, constraint.type, constraint.level);
+        if (!scheme.type)
+        {
+            throw std::runtime_error("infinite type");
+        }
+
+        _schemes[constraint.index] = scheme;
+        begin = end + 1;
+    }
+
+    // Binding never searches for infinite types, so search them all at once
+    if (!checkCycles(_types))
+    {
+        throw std::runtime_error("infinite type");
+    }
+}
+
+void ConstraintSolver::solveBatch(size_t begin, size_t end, bool inOrder)
+{
+    // In the order SemanticAnalyzer unifies the same types
+    if (inOrder)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            if (_constraints[i].kind == Constraint::Instance)
+            {
+                solveInstance(_constraints[i]);
+            }
+            else
+            {
+                solveApply(_constraints[i], true);
+            }
+        }
+
+        return;
+    }
+
+    // Instances first, so that every call of a let-bound function finds it
+    // already an arrow
+    for (size_t i = begin; i < end; ++i)
+    {
+        if (_constraints[i].kind == Constraint::Instance)
+        {
+            solveInstance(_constraints[i]);
+        }
+    }
+
+    _deferred.clear();
+    for (size_t i = begin; i < end; ++i)
+    {
+        if (_constraints[i].kind == Constraint::Apply && !solveApply(_constraints[i], false))
+        {
+            _deferred.push_back(i);
+        }
+    }
+
+    for (uint32_t i : _deferred)
+    {
+        solveApply(_constraints[i], true);
+    }
+}
+
+void ConstraintSolver::solveInstance(const Constraint& constraint)
+{
+    // The variable is fresh, so binding it cannot fail
+    typ::TypeScheme scheme = _schemes[constraint.index];
+    Type* type = scheme.quantifiers ? instantiate(_types, scheme, constraint.level) : scheme.type;
+    bind(_types, constraint.result, type);
+}
+
+bool ConstraintSolver::solveApply(const Constraint& constraint, bool force)
+{
+    Type* fnType = constraint.type->root();
+    Type** argTypes = _arguments.data() + constraint.index;
+    size_t count = constraint.count;
+
+    bool unified = true;
+    if (fnType->tag() == typ::kArrow)
+    {
+        // Unify the inputs with the arguments in place
+        Arrow* arrow = static_cast<Arrow*>(fnType);
+        unified = arrow->inputs.size() == count;
+        for (size_t i = 0; i < count && unified; ++i)
+        {
+            unified = unify(_types, arrow->inputs[i], argTypes[i]);
+        }
+
+        unified = unified && unify(_types, constraint.result, arrow->output);
+    }
+    else if (!force)
+    {
+        return false;
+    }
+    else
+    {
+        Span<Type*> inputs = _types.makeInputs(count);
+        std::copy(argTypes, argTypes + count, inputs.begin());
+
+        unified = unify(_types, fnType, _types.makeArrow(inputs, constraint.result));
+    }
+
+    // It may have failed on an infinite type made earlier, which is reported
+    // as such, as SemanticAnalyzer does
+    if (!unified)
+    {
+        throw std::runtime_error(checkCycles(_types) ? "unification error" : "infinite type");
+    }
+
+    return true;
+}
+
+void ConstraintSolver::visit(ast::Var* node)
+{
+    int baseSize = _env.size();
+    if (node->slot < baseSize)
+    {
+        typ::TypeScheme scheme = _env.scheme(node->slot);
+        _results.push(scheme.quantifiers ? instantiate(_types, scheme, _level) : scheme.type);
+        return;
+    }
+
+    const Binding& binding = _bindings[node->slot - baseSize];
+    if (binding.let == -1)
+    {
+        _results.push(binding.type);
+        return;
+    }
+
+    // The let's scheme is not known yet
+    Var* result = _types.makeUnbound(_level);
+    _constraints.push_back({Constraint::Instance, _level, uint32_t(binding.let), 0, nullptr, result});
+    _results.push(result);
+}
+
+void ConstraintSolver::visit(ast::Call* node)
+{
+    size_t count = node->arguments.size();
+    if (size_t(_state) <= count)
+    {
+        suspend(node, _state + 1);
+        descend(_state == 0 ? node->function : node->arguments[_state - 1]);
+        return;
+    }
+
+    size_t base = _results.size() - count - 1;
+    uint32_t first = _arguments.size();
+    _arguments.insert(_arguments.end(), _results.data() + base + 1, _results.data() + base + 1 + count);
+
+    Var* result = _types.makeUnbound(_level);
+    _constraints.push_back({Constraint::Apply, _level, first, uint32_t(count), _results[base], result});
+
+    _results.truncate(base);
+    _results.push(result);
+}
+
+void ConstraintSolver::visit(ast::Fun* node)
+{
+    size_t count = node->parameters.size();
+
+    if (_state == 0)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            Type* paramType = _types.makeUnbound(_level);
+            _bindings.push_back({paramType, -1});
+            _results.push(paramType);
+        }
+
+        suspend(node, 1);
+        descend(node->body);
+        return;
+    }
+
+    Type* bodyType = _results.pop();
+
+    size_t base = _results.size() - count;
+    Span<Type*> paramTypes = _types.makeInputs(count);
+    std::copy(_results.data() + base, _results.data() + base + count, paramTypes.begin());
+
+    _results.truncate(base);
+    _bindings.resize(_bindings.size() - count);
+
+    _results.push(_types.makeArrow(paramTypes, bodyType));
+}
+
+void ConstraintSolver::visit(ast::Let* node)
+{
+    switch (_state)
+    {
+        case 0:
+            _level += 1;
+
+            suspend(node, 1);
+            descend(node->value);
+            break;
+
+        case 1:
+        {
+            _level -= 1;
+            Type* valueType = _results.pop();
+
+            int let = _schemes.size();
+            _schemes.push_back({nullptr, 0});
+            _constraints.push_back({Constraint::Generalize, _level, uint32_t(let), 0, valueType, nullptr});
+
+            _bindings.push_back({nullptr, let});
+
+            suspend(node, 2);
+            descend(node->body);
+            break;
+        }
+
+        case 2:
+            _bindings.pop_back();
+            break;
+    }
+}
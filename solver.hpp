@@ -0,0 +1,125 @@
+#pragma once
+#include "ast.hpp"
+#include "type_env.hpp"
+#include "types.hpp"
+#include "work_stack.hpp"
+#include <cstdint>
+#include <vector>
+
+// Inference in two phases, as an alternative to SemanticAnalyzer's single pass:
+// the program is first walked to build a flat buffer of constraints between
+// the types of its nodes, which are only then solved.
+//
+// Generalizing a let needs the constraints of its value solved, and using it
+// needs it generalized, so the buffer is solved in batches: the runs of
+// constraints between one let value's generalization and the next. Within a
+// batch the order is free, and is chosen to save unification work. The types
+// found are those which SemanticAnalyzer::infer finds, up to the naming of
+// their variables, and so are the errors: a program which fails is solved
+// again in SemanticAnalyzer's order, to report the error that it would. Only
+// this solver's eq and id (see bindMonomorphic) keep what the first attempt
+// bound, so a program which fails on them may still report another error.
+class ConstraintSolver : public ast::Visitor
+{
+public:
+    // Starts from the shared prelude, without copying it, and binds its own
+    // eq and id (see bindMonomorphic)
+    ConstraintSolver();
+
+    // Resolves names in the given program, then infers its type. Throws on the
+    // first error.
+    typ::Type* infer(ast::Expr* node);
+
+    // Number of constraints built for the last program
+    size_t constraints() const { return _constraints.size(); }
+
+    void visit(ast::Var* node) override;
+    void visit(ast::Call* node) override;
+    void visit(ast::Fun* node) override;
+    void visit(ast::Let* node) override;
+
+private:
+    struct Constraint
+    {
+        enum Kind : uint8_t
+        {
+            // The variable result stands for an instance of the scheme of
+            // the let numbered index, at the given level
+            Instance,
+
+            // The function type is applied to count argument types, starting
+            // from index in _arguments, and the variable result stands for
+            // its output
+            Apply,
+
+            // The type is the value of the let numbered index, to be
+            // generalized at the given level
+            Generalize,
+        };
+
+        Kind kind;
+        int level;
+        uint32_t index;
+        uint32_t count;
+        typ::Type* type;
+        typ::Var* result;
+    };
+
+    // The binding of a slot above _env: a monomorphic type, or the let whose
+    // scheme is not known until it has been solved
+    struct Binding
+    {
+        typ::Type* type;
+        int let;
+    };
+
+    // Builds and solves the constraints of the program. In order, each batch
+    // is solved as SemanticAnalyzer would solve it, without saving any work.
+    typ::Type* check(ast::Expr* node, bool inOrder);
+
+    // Walks the program with an explicit stack, as SemanticAnalyzer does, and
+    // returns the type of the program, in terms of the constraints' variables
+    typ::Type* generate(ast::Expr* node);
+
+    void suspend(ast::Expr* node, int state) { _frames.push({node, state}); }
+    void descend(ast::Expr* child) { _frames.push({child, 0}); }
+
+    void solve(bool inOrder);
+    void solveBatch(size_t begin, size_t end, bool inOrder);
+    void solveInstance(const Constraint& constraint);
+
+    // Solving the call of an unknown function means building an arrow for it.
+    // Unless forced, such a call is left (returning false) in case the
+    // function becomes known by solving other calls first.
+    bool solveApply(const Constraint& constraint, bool force);
+
+    struct Frame
+    {
+        ast::Expr* node;
+        int state;
+    };
+
+    WorkStack<Frame> _frames;
+    int _state = 0;
+
+    // Types of the visited nodes whose parents have yet to consume them
+    WorkStack<typ::Type*> _results;
+
+    int _level = 0;
+
+    // The prelude and this solver's eq and id, below the program's bindings
+    typ::TypeEnvironment _env;
+    std::vector<Binding> _bindings;
+
+    std::vector<Constraint> _constraints;
+    std::vector<typ::Type*> _arguments;
+
+    // Scheme of each let, once solved
+    std::vector<typ::TypeScheme> _schemes;
+
+    // Calls left until the end of their batch
+    std::vector<uint32_t> _deferred;
+
+    // Owns every type created by this solver (including the result of infer)
+    typ::TypeArena _types;
+};
@@ -0,0 +1,50 @@
+#include "source_file.hpp"
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+SourceFile::SourceFile(const std::string& path)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd == -1)
+    {
+        throw std::runtime_error("cannot open file: " + path);
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) == -1)
+    {
+        close(fd);
+        throw std::runtime_error("cannot read file: " + path);
+    }
+
+    _size = info.st_size;
+
+    // Empty files cannot be mapped, but there is nothing to map anyway
+    if (_size > 0)
+    {
+        void* data = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED)
+        {
+            close(fd);
+            throw std::runtime_error("cannot map file: " + path);
+        }
+
+        // Sources are scanned front to back exactly once
+        madvise(data, _size, MADV_SEQUENTIAL);
+        _data = static_cast<const char*>(data);
+    }
+
+    // The mapping stays valid after the descriptor is closed
+    close(fd);
+}
+
+SourceFile::~SourceFile()
+{
+    if (_data)
+    {
+        munmap(const_cast<char*>(_data), _size);
+    }
+}
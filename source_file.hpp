@@ -0,0 +1,21 @@
+#pragma once
+#include <string>
+#include <string_view>
+
+// Read-only view of a file's contents, memory-mapped rather than copied
+class SourceFile
+{
+public:
+    // Throws if the file cannot be opened or mapped
+    SourceFile(const std::string& path);
+    ~SourceFile();
+
+    SourceFile(const SourceFile&) = delete;
+    SourceFile& operator=(const SourceFile&) = delete;
+
+    std::string_view text() const { return std::string_view(_data, _size); }
+
+private:
+    const char* _data = nullptr;
+    size_t _size = 0;
+};
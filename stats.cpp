@@ -0,0 +1,50 @@
+#include "stats.hpp"
+
+namespace typ
+{
+
+static thread_local Stats* t_current = nullptr;
+
+Stats::Scope::Scope(Stats& stats)
+: _previous(t_current)
+{
+    t_current = &stats;
+}
+
+Stats::Scope::~Scope()
+{
+    t_current = _previous;
+}
+
+Stats* Stats::current()
+{
+    return t_current;
+}
+
+std::ostream& operator<<(std::ostream& out, const Stats& stats)
+{
+    auto perLet = [&](uint64_t count) {
+        return stats.lets ? double(count) / stats.lets : 0.0;
+    };
+
+    out << "unify calls: " << stats.unifyCalls << "\n";
+    out << "unify max depth: " << stats.unifyMaxDepth << "\n";
+    out << "occurs nodes visited: " << stats.occursNodes << "\n";
+    out << "level adjustments: " << stats.levelAdjustments << "\n";
+    out << "root calls: " << stats.rootCalls << "\n";
+    out << "root links followed: " << stats.rootLinks << "\n";
+    out << "root max chain: " << stats.rootMaxChain << "\n";
+    out << "root compressions: " << stats.rootCompressions << "\n";
+    out << "constants allocated: " << stats.constants << "\n";
+    out << "arrows allocated: " << stats.arrows << "\n";
+    out << "vars allocated: " << stats.vars << "\n";
+    out << "lets: " << stats.lets << "\n";
+    out << "instantiations: " << stats.instantiations << " (" << perLet(stats.instantiations) << " per let)\n";
+    out << "generalizations: " << stats.generalizations << " (" << perLet(stats.generalizations) << " per let)\n";
+    out << "environment lookups: " << stats.lookups << "\n";
+    out << "max scope depth: " << stats.maxScopeDepth << "\n";
+
+    return out;
+}
+
+} // namespace typ
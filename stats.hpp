@@ -0,0 +1,81 @@
+#pragma once
+#include <cstdint>
+#include <iostream>
+
+namespace typ
+{
+
+// Counters for the hot paths of type inference
+//
+// They are only collected when the library is built with HM_STATS (cmake
+// -DHM_STATS=ON). Otherwise the counting macros below compile to nothing and
+// every counter stays at zero.
+struct Stats
+{
+    uint64_t unifyCalls = 0;
+    uint64_t unifyMaxDepth = 0;
+
+    uint64_t occursNodes = 0;
+    uint64_t levelAdjustments = 0;
+
+    uint64_t rootCalls = 0;
+    uint64_t rootLinks = 0; // total chain length walked
+    uint64_t rootMaxChain = 0;
+    uint64_t rootCompressions = 0;
+
+    uint64_t constants = 0;
+    uint64_t arrows = 0;
+    uint64_t vars = 0;
+
+    uint64_t lets = 0;
+    uint64_t instantiations = 0;
+    uint64_t generalizations = 0;
+
+    uint64_t lookups = 0;
+    uint64_t maxScopeDepth = 0;
+
+#ifdef HM_STATS
+    static constexpr bool enabled = true;
+#else
+    static constexpr bool enabled = false;
+#endif
+
+    // Counters are recorded into the Stats of the innermost live Scope on the
+    // current thread (if any)
+    class Scope
+    {
+    public:
+        Scope(Stats& stats);
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        Stats* _previous;
+    };
+
+    static Stats* current();
+};
+
+std::ostream& operator<<(std::ostream& out, const Stats& stats);
+
+} // namespace typ
+
+#ifdef HM_STATS
+
+#define HM_COUNT(counter, n) \
+    do { if (typ::Stats* hmStats_ = typ::Stats::current()) hmStats_->counter += (n); } while (0)
+
+#define HM_MAX(counter, value) \
+    do { \
+        if (typ::Stats* hmStats_ = typ::Stats::current()) \
+            if (uint64_t(value) > hmStats_->counter) hmStats_->counter = (value); \
+    } while (0)
+
+#else
+
+#define HM_COUNT(counter, n) do {} while (0)
+#define HM_MAX(counter, value) do {} while (0)
+
+#endif
@@ -0,0 +1,94 @@
+#include "lexer.hpp"
+#include "scan.hpp"
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+static std::vector<std::string> lex(const std::string& program)
+{
+    Lexer lexer(program);
+
+    std::vector<std::string> tokens;
+    while (lexer.peek() != Token::Eof)
+    {
+        Token token = lexer.expect(lexer.peek());
+        tokens.push_back(std::to_string(token.type) + ":" + std::string(token.lexeme));
+    }
+
+    return tokens;
+}
+
+TEST(LexerTest, Scanning)
+{
+    // Every byte, at every position relative to the 16-byte blocks
+    for (int c = 0; c < 256; ++c)
+    {
+        for (size_t offset = 0; offset < 40; ++offset)
+        {
+            std::string spaces(offset, ' ');
+            spaces[offset / 2] = '\t';
+            spaces += char(c);
+            spaces += "  ";
+            const char* begin = spaces.data();
+            const char* end = begin + spaces.size();
+            EXPECT_EQ(skipSpace(begin, end), skipSpaceScalar(begin, end)) << c << " at " << offset;
+
+            std::string identifier(offset, 'a');
+            identifier[offset / 2] = '_';
+            identifier += char(c);
+            identifier += "zZ09";
+            begin = identifier.data();
+            end = begin + identifier.size();
+            EXPECT_EQ(skipIdentifier(begin, end), skipIdentifierScalar(begin, end)) << c << " at " << offset;
+        }
+    }
+
+    std::string whitespace = " \t\n\v\f\r";
+    for (char c : whitespace)
+    {
+        EXPECT_TRUE(isSpace(c));
+    }
+    EXPECT_FALSE(isSpace('\b'));
+    EXPECT_FALSE(isSpace('\x0e'));
+    EXPECT_FALSE(isIdentifier('@'));
+    EXPECT_FALSE(isIdentifier('['));
+    EXPECT_FALSE(isIdentifier('`'));
+    EXPECT_FALSE(isIdentifier('{'));
+    EXPECT_FALSE(isIdentifierStart('0'));
+}
+
+TEST(LexerTest, Tokens)
+{
+    // Identifiers longer than any keyword take the fast path, so check both
+    // sides of that length, and keywords as prefixes of identifiers
+    std::string program = "let forall_ = fun forall, letter ->\n        in_the_middle(funny)   in  f";
+    std::vector<std::string> expected = {
+        std::to_string(Token::Let) + ":let",
+        std::to_string(Token::Ident) + ":forall_",
+        std::to_string(Token::Equals) + ":=",
+        std::to_string(Token::Fun) + ":fun",
+        std::to_string(Token::Forall) + ":forall",
+        std::to_string(Token::Comma) + ":,",
+        std::to_string(Token::Ident) + ":letter",
+        std::to_string(Token::Arrow) + ":->",
+        std::to_string(Token::Ident) + ":in_the_middle",
+        std::to_string(Token::Lparen) + ":(",
+        std::to_string(Token::Ident) + ":funny",
+        std::to_string(Token::Rparen) + ":)",
+        std::to_string(Token::In) + ":in",
+        std::to_string(Token::Ident) + ":f",
+    };
+    EXPECT_EQ(lex(program), expected);
+
+    // Trailing whitespace ends the input
+    EXPECT_EQ(lex("zero \n\t"), std::vector<std::string>{std::to_string(Token::Ident) + ":zero"});
+
+    // Text which is not a token ends the input too
+    Lexer lexer("a_long_identifier $ one");
+    lexer.expect(Token::Ident);
+    EXPECT_EQ(lexer.peek(), Token::Err);
+    EXPECT_EQ(lexer.current().lexeme, "$");
+    EXPECT_FALSE(lexer.accept(Token::Ident));
+    EXPECT_TRUE(lexer.accept(Token::Err));
+    EXPECT_EQ(lexer.peek(), Token::Err);
+}
@@ -1,21 +1,70 @@
+#include "bench/corpus.hpp"
+#include "fingerprint.hpp"
+#include "interface.hpp"
+#include "module.hpp"
 #include "parser.hpp"
 #include "semantic.hpp"
+#include "solver.hpp"
 #include <gtest/gtest.h>
+#include <fstream>
 #include <iostream>
+#include <thread>
 
-std::string inferType(const std::string& program)
+template <typename Engine>
+static std::string inferWith(const std::string& program)
 {
     Parser parser(program);
     ast::Context ast = parser.parse();
 
-    SemanticAnalyzer semant;
-    typ::Type* type = semant.infer(ast.root());
+    Engine engine;
+    typ::Type* type = engine.infer(ast.root());
 
     std::stringstream ss;
     ss << type;
     return ss.str();
 }
 
+// Both engines must find the same type, or the same error
+std::string inferType(const std::string& program)
+{
+    std::string solved;
+    try
+    {
+        solved = inferWith<ConstraintSolver>(program);
+    }
+    catch (const std::runtime_error& error)
+    {
+        solved = std::string("error: ") + error.what();
+    }
+
+    try
+    {
+        std::string type = inferWith<SemanticAnalyzer>(program);
+        EXPECT_EQ(solved, type) << program;
+        return type;
+    }
+    catch (const std::runtime_error& error)
+    {
+        EXPECT_EQ(solved, std::string("error: ") + error.what()) << program;
+        throw;
+    }
+}
+
+// The error which both engines report, if any
+static std::string errorOf(const std::string& program)
+{
+    try
+    {
+        inferType(program);
+    }
+    catch (const std::runtime_error& error)
+    {
+        return error.what();
+    }
+
+    return "";
+}
+
 TEST(SemanticTest, Inference)
 {
     EXPECT_EQ(inferType("let f = fun x, y -> x in f(zero, one)"), "Int");
@@ -36,6 +85,10 @@ TEST(SemanticTest, Inference)
     EXPECT_EQ(inferType("let f = fun x -> fun y -> y in f(one)"), "a -> a");
     EXPECT_EQ(inferType("fun x, y -> x"), "|a, b| -> a");
     EXPECT_EQ(inferType("fun f -> eq(f(one), one)"), "|Int -> Int| -> Bool");
+
+    // eq and id are monomorphic, so a program may only use them at one type
+    EXPECT_THROW(inferType("let b = eq(one, zero) in eq(b, true)"), std::runtime_error);
+    EXPECT_THROW(inferType("let i = id(id) in i(one)"), std::runtime_error);
 }
 
 // These tests would fail with naive generalization
@@ -45,6 +98,24 @@ TEST(SemanticTest, LevelGeneralization)
     EXPECT_EQ(inferType("fun x -> let y = fun z -> x in y"), "a -> (b -> a)");
 }
 
+TEST(SemanticTest, Scoping)
+{
+    // Inner bindings shadow outer ones, including the prelude
+    EXPECT_EQ(inferType("let x = one in let x = true in x"), "Bool");
+    EXPECT_EQ(inferType("fun x -> let x = one in x"), "a -> Int");
+    EXPECT_EQ(inferType("let one = true in one"), "Bool");
+    EXPECT_EQ(inferType("fun x, x -> x"), "|a, b| -> b");
+
+    // ... but only within their body
+    EXPECT_EQ(inferType("let f = fun x -> x in let g = fun f -> f in f(one)"), "Int");
+    EXPECT_EQ(inferType("(fun one -> one)(true)"), "Bool");
+
+    // Undefined variables
+    EXPECT_THROW(inferType("undefined"), std::runtime_error);
+    EXPECT_THROW(inferType("let f = fun x -> f(x) in f"), std::runtime_error);
+    EXPECT_THROW(inferType("let f = (fun x -> x) in x"), std::runtime_error);
+}
+
 TEST(SemanticTest, TypeErrors)
 {
     // Wrong argument types
@@ -52,9 +123,442 @@ TEST(SemanticTest, TypeErrors)
 
     // Infinite recursive type
     EXPECT_THROW(inferType("fun x -> let y = x in y(y)"), std::runtime_error);
+    EXPECT_THROW(inferType("(fun x -> one)(fun y -> y(y))"), std::runtime_error);
 
     // Wrong function arity
     EXPECT_THROW(inferType("add(one, one, one)"), std::runtime_error);
+
+    // v0(v0) makes v0's type infinite without searching it, and only the outer
+    // call fails to unify, but that is still reported as an infinite type
+    EXPECT_EQ(errorOf("(fun v0 -> v0(v0))(fun v0 -> succ(one))"), "infinite type");
+
+    // The solver meets add's failure before it solves x(x), but reports the
+    // infinite type which the analyzer meets first
+    EXPECT_EQ(errorOf("fun x -> add(x(x), true)"), "infinite type");
+    EXPECT_EQ(errorOf("add(zero, true)"), "unification error");
+}
+
+// Checks programs one after the other with the same engine
+template <typename Engine>
+static void expectReusableAfterError()
+{
+    Engine engine;
+    auto infer = [&](const std::string& program) {
+        Parser parser(program);
+        ast::Context ast = parser.parse();
+
+        std::stringstream ss;
+        ss << engine.infer(ast.root());
+        return ss.str();
+    };
+
+    // Neither the failed program's cycle nor its bindings survive it
+    EXPECT_THROW(infer("fun x -> add(x(x), true)"), std::runtime_error);
+    EXPECT_EQ(infer("one"), "Int");
+
+    EXPECT_THROW(infer("fun x -> add(x(x), x(true))"), std::runtime_error);
+    EXPECT_EQ(infer("one"), "Int");
+
+    EXPECT_THROW(infer("let y = one in fun x -> let z = x in add(z, true)"), std::runtime_error);
+    EXPECT_THROW(infer("y"), std::runtime_error);
+    EXPECT_EQ(infer("fun x -> let y = x in y"), "a -> a");
+}
+
+TEST(SemanticTest, ReuseAfterError)
+{
+    expectReusableAfterError<SemanticAnalyzer>();
+}
+
+TEST(SemanticTest, SolverReuseAfterError)
+{
+    expectReusableAfterError<ConstraintSolver>();
+}
+
+// Every error found, with its position
+static std::string diagnose(const std::string& program)
+{
+    Diagnostics diagnostics;
+    Parser parser(program);
+    ast::Context ast = parser.parse(diagnostics);
+
+    SemanticAnalyzer semant;
+    typ::Type* type = ast.root() ? semant.infer(ast.root(), diagnostics) : nullptr;
+    EXPECT_EQ(type == nullptr, !diagnostics.empty());
+
+    std::string result;
+    for (const Diagnostic& diagnostic : diagnostics.all())
+    {
+        result += format(diagnostic, program) + "; ";
+    }
+
+    return result;
+}
+
+TEST(SemanticTest, Diagnostics)
+{
+    EXPECT_EQ(diagnose("let f = fun x -> x in f(one)"), "");
+
+    // Checking goes on after each error, and a failed call or let does not
+    // cause more errors where it is used
+    std::string program = "let a = add(zero, true) in\n"
+                          "let b = nonzero(a) in\n"
+                          "let c = undefined in\n"
+                          "add(b, c)";
+    EXPECT_EQ(diagnose(program), "1:9: unification error; 3:9: undefined variable: undefined; 4:1: unification error; ");
+
+    // Infinite types are reported at the call which made them, however late
+    // they are found
+    EXPECT_EQ(diagnose("let f = fun x -> x(x) in f(f)"), "1:18: infinite type; ");
+    EXPECT_EQ(diagnose("fun x -> x(x)"), "1:10: infinite type; ");
+    EXPECT_EQ(diagnose("(fun v0 -> v0(v0))(fun v0 -> succ(one))"), "1:12: infinite type; ");
+
+    // Parsing stops at the first syntax error
+    EXPECT_EQ(diagnose("let x = in x"), "1:9: syntax error; ");
+    EXPECT_EQ(diagnose("add(one,\n  $)"), "2:3: lexer error; ");
+    EXPECT_EQ(diagnose("fun x ->"), "1:9: syntax error; ");
+    EXPECT_EQ(diagnose("f(x"), "1:4: syntax error; ");
+
+    // Nodes span their source text
+    Parser parser("let f = fun x -> x in f(one)");
+    ast::Context ast = parser.parse();
+    auto let = static_cast<ast::Let*>(ast.root());
+    EXPECT_EQ(let->range.begin, 0u);
+    EXPECT_EQ(let->range.end, 28u);
+    EXPECT_EQ(let->value->range.begin, 8u);
+    EXPECT_EQ(let->value->range.end, 18u);
+    EXPECT_EQ(let->body->range.begin, 22u);
+}
+
+TEST(SemanticTest, Symbols)
+{
+    Parser parser("let f = fun x, y -> x in f(f)");
+    ast::Context ast = parser.parse();
+
+    // Every occurrence of a name is the same interned symbol
+    auto* let = static_cast<ast::Let*>(ast.root());
+    auto* fun = static_cast<ast::Fun*>(let->value);
+    EXPECT_TRUE(static_cast<ast::Var*>(fun->body)->name == fun->parameters[0]);
+    EXPECT_TRUE(fun->parameters[0] != fun->parameters[1]);
+    EXPECT_EQ(fun->parameters[1].str(), "y");
+    EXPECT_EQ(ast.symbolCount(), 3u);
+}
+
+TEST(SemanticTest, Stats)
+{
+    Parser parser("let f = fun x -> x in f(f(one))");
+    ast::Context ast = parser.parse();
+
+    SemanticAnalyzer semant;
+    semant.infer(ast.root());
+
+    const typ::Stats& stats = semant.stats();
+    if (typ::Stats::enabled)
+    {
+        EXPECT_EQ(stats.lets, 1u);
+        // Only f is instantiated: x and one are monomorphic
+        EXPECT_EQ(stats.instantiations, 2u);
+
+        // Calls of known functions unify the arguments with their inputs, and
+        // allocate nothing: the arrows are the function, its generalization
+        // and its two instances (the prelude is shared, and built only once)
+        EXPECT_EQ(stats.unifyMaxDepth, 1u);
+        EXPECT_EQ(stats.arrows, 4u);
+        EXPECT_GT(stats.unifyCalls, 0u);
+    }
+    else
+    {
+        EXPECT_EQ(stats.unifyCalls, 0u);
+    }
+}
+
+std::string inferCached(typ::TypeCache& cache, const std::string& program)
+{
+    Parser parser(program);
+    ast::Context ast = parser.parse();
+
+    SemanticAnalyzer semant;
+    semant.setCache(&cache);
+    typ::Type* type = semant.infer(ast.root());
+
+    std::stringstream ss;
+    ss << type;
+    return ss.str();
+}
+
+// Re-checking an edited program re-infers only the changed bindings and
+// those which depend on them
+TEST(SemanticTest, Incremental)
+{
+    typ::TypeCache cache;
+
+    auto program = [](const std::string& f, const std::string& h) {
+        return "let f = " + f + " in let g = fun y -> f(f(y)) in let h = " + h + " in h(g(zero))";
+    };
+
+    std::string original = program("fun x -> add(x, one)", "fun z -> nonzero(z)");
+    EXPECT_EQ(inferCached(cache, original), "Bool");
+    EXPECT_EQ(cache.counts().hits, 0u);
+    EXPECT_EQ(cache.counts().misses, 3u);
+
+    // Nothing changed
+    cache.resetCounts();
+    EXPECT_EQ(inferCached(cache, original), "Bool");
+    EXPECT_EQ(cache.counts().hits, 3u);
+    EXPECT_EQ(cache.counts().misses, 0u);
+    EXPECT_GT(cache.counts().nodesSkipped, 10u);
+
+    // Only h changed
+    cache.resetCounts();
+    EXPECT_EQ(inferCached(cache, program("fun x -> add(x, one)", "fun z -> nonzero(succ(z))")), "Bool");
+    EXPECT_EQ(cache.counts().hits, 2u);
+    EXPECT_EQ(cache.counts().misses, 1u);
+
+    // f changed, so g (which uses it) is re-inferred too
+    cache.resetCounts();
+    EXPECT_EQ(inferCached(cache, program("fun x -> succ(x)", "fun z -> nonzero(z)")), "Bool");
+    EXPECT_EQ(cache.counts().hits, 1u);
+    EXPECT_EQ(cache.counts().misses, 2u);
+
+    // ... which matters when the type of f changes
+    EXPECT_THROW(inferCached(cache, program("fun x -> nonzero(x)", "fun z -> z")), std::runtime_error);
+
+    // Values which share type variables with their context are never cached
+    cache.resetCounts();
+    EXPECT_EQ(inferCached(cache, "fun x -> let y = x in y"), "a -> a");
+    EXPECT_EQ(inferCached(cache, "fun x -> let y = x in y"), "a -> a");
+    EXPECT_EQ(inferCached(cache, "let i = id in i"), "a -> a");
+    EXPECT_EQ(inferCached(cache, "let i = id in i"), "a -> a");
+    EXPECT_EQ(cache.counts().hits, 0u);
+
+    // Cached types are interned in each analysis that reuses them
+    EXPECT_EQ(inferCached(cache, "let n = succ(one) in let s = succ in eq(s(n), one)"), "Bool");
+    EXPECT_EQ(inferCached(cache, "let n = succ(one) in let s = succ in eq(s(n), one)"), "Bool");
+    EXPECT_EQ(inferCached(cache, "let f = fun x -> x in f(f)"), "a -> a");
+    EXPECT_EQ(inferCached(cache, "let f = fun x -> x in f(f)"), "a -> a");
+
+    // A colliding fingerprint only hits for a value of the same size
+    typ::TypeArena types;
+    typ::TypeScheme scheme{types.makeConstant("Int"), 0};
+    cache.insert(1, scheme, 3);
+    EXPECT_EQ(cache.find(1, 4, types).type, nullptr);
+    EXPECT_EQ(cache.find(1, 3, types).type, scheme.type);
+}
+
+std::string repeat(const std::string& text, int count)
+{
+    std::string result;
+    for (int i = 0; i < count; ++i)
+    {
+        result += text;
+    }
+
+    return result;
+}
+
+// Far deeper than the native stack would allow if parsing or checking recursed
+TEST(SemanticTest, DeepNesting)
+{
+    const int depth = 200000;
+
+    EXPECT_EQ(inferType(repeat("let x = one in ", depth) + "x"), "Int");
+    EXPECT_EQ(inferType(repeat("let x = ", depth) + "one" + repeat(" in x", depth)), "Int");
+    EXPECT_EQ(inferType("let f = " + repeat("fun x -> ", depth) + "x in zero"), "Int");
+    EXPECT_EQ(inferType(repeat("(", depth) + "one" + repeat(")", depth)), "Int");
+    EXPECT_EQ(inferType(repeat("succ(", depth) + "one" + repeat(")", depth)), "Int");
+    EXPECT_EQ(inferType("let i = fun x -> x in " + repeat("i(", depth) + "i" + repeat(")", depth)), "a -> a");
+}
+
+TEST(SemanticTest, GeneratedPrograms)
+{
+    bench::ProgramShape shape;
+    shape.definitions = 50;
+    shape.illTyped = 50;
+
+    // The same seed always gives the same programs
+    bench::ProgramGenerator generator(shape, 1);
+    EXPECT_EQ(bench::ProgramGenerator(shape, 1).generate().text, generator.generate().text);
+
+    for (int i = 0; i < 20; ++i)
+    {
+        bench::GeneratedProgram program = generator.generate();
+        if (program.wellTyped)
+        {
+            EXPECT_EQ(inferType(program.text), "Int") << program.text;
+        }
+        else
+        {
+            EXPECT_THROW(inferType(program.text), std::runtime_error) << program.text;
+        }
+    }
+}
+
+// Analyzers share no state, so they can run concurrently with identical results
+TEST(SemanticTest, Concurrency)
+{
+    const char* program = "let twice = fun f -> fun x -> f(f(x)) in twice(twice)";
+    std::string expected = inferType(program);
+
+    std::vector<std::string> results(8);
+    std::vector<std::thread> threads;
+    for (auto& result : results)
+    {
+        threads.emplace_back([&result, program] {
+            for (int i = 0; i < 100; ++i)
+            {
+                result = inferType(program);
+            }
+        });
+    }
+
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    for (auto& result : results)
+    {
+        EXPECT_EQ(result, expected);
+    }
+}
+
+// Types of a module's declarations, one "name: type" per line
+std::string inferModule(const std::string& program, unsigned threads)
+{
+    Parser parser(program);
+    ast::Context module = parser.parseModule();
+
+    ThreadPool pool(threads);
+    ModuleAnalyzer analyzer;
+    std::vector<typ::TypeScheme> types = analyzer.infer(module, pool);
+
+    std::stringstream ss;
+    for (size_t i = 0; i < types.size(); ++i)
+    {
+        ss << module.declarations()[i].name.str() << ": " << types[i].type << "\n";
+    }
+
+    return ss.str();
+}
+
+TEST(SemanticTest, Modules)
+{
+    // Declarations may refer to later ones, and to each other
+    const char* program =
+        "let twice = fun f -> compose(f, f)\n"
+        "let compose = fun f, g -> fun x -> f(g(x))\n"
+        "let even = fun n -> let m = odd(n) in nonzero(n)\n"
+        "let odd = fun n -> even(succ(n))\n"
+        "let inc2 = twice(succ)\n"
+        "let one = true\n";
+
+    const char* expected =
+        "twice: |a -> a| -> (a -> a)\n"
+        "compose: |a -> b, c -> a| -> (c -> b)\n"
+        "even: Int -> Bool\n"
+        "odd: Int -> Bool\n"
+        "inc2: Int -> Int\n"
+        "one: Bool\n";
+
+    // Independent groups may be inferred in any order
+    EXPECT_EQ(inferModule(program, 1), expected);
+    EXPECT_EQ(inferModule(program, 4), expected);
+
+    // Many groups become ready while others are still running
+    std::string chains;
+    for (int chain = 0; chain < 50; ++chain)
+    {
+        std::string prefix = "c" + std::to_string(chain) + "_";
+        chains += "let " + prefix + "0 = fun x -> add(x, one)\n";
+        for (int i = 1; i < 10; ++i)
+        {
+            chains += "let " + prefix + std::to_string(i) + " = fun x -> " + prefix + std::to_string(i - 1) + "(x)\n";
+        }
+    }
+
+    EXPECT_EQ(inferModule(chains, 4), inferModule(chains, 1));
+
+    // Within a group, declarations are monomorphic
+    EXPECT_THROW(inferModule("let f = fun x -> let a = f(one) in f(true)", 2), std::runtime_error);
+    EXPECT_EQ(inferModule("let f = fun x -> x\nlet g = let a = f(one) in f(true)", 2), "f: a -> a\ng: Bool\n");
+
+    // The failing group with the earliest declaration is reported
+    try
+    {
+        inferModule("let c = a\nlet a = add(one, true)\nlet b = add(true, one)", 4);
+        FAIL();
+    }
+    catch (std::runtime_error& e)
+    {
+        EXPECT_STREQ(e.what(), "a: unification error");
+    }
+
+    EXPECT_THROW(inferModule("let a = one\nlet a = one", 2), std::runtime_error);
+    EXPECT_THROW(inferModule("let a = b", 2), std::runtime_error);
+}
+
+TEST(SemanticTest, Interfaces)
+{
+    std::string program = "let compose = fun f, g -> fun x -> f(g(x))\nlet inc2 = compose(succ, succ)\n";
+    std::string path = testing::TempDir() + "interface_test.hmi";
+
+    Parser parser(program);
+    ast::Context module = parser.parseModule();
+
+    ThreadPool pool(2);
+    ModuleAnalyzer analyzer;
+    std::vector<typ::TypeScheme> types = analyzer.infer(module, pool);
+
+    typ::TypeEnvironment written;
+    for (size_t i = 0; i < types.size(); ++i)
+    {
+        written.insert(module.declarations()[i].name.str(), types[i]);
+    }
+
+    Interface::write(path, hashSource(program), written);
+
+    // Loaded signatures are generic, and can be instantiated as usual
+    {
+        Interface interface(path);
+        EXPECT_FALSE(interface.matches(hashSource(program + " ")));
+        ASSERT_TRUE(interface.matches(hashSource(program)));
+
+        typ::TypeArena arena;
+        typ::TypeEnvironment env;
+        interface.load(arena, env);
+
+        ASSERT_EQ(env.size(), 2);
+        std::stringstream ss;
+        ss << env.name(0) << ": " << env.type(0) << ", " << env.name(1) << ": " << env.type(1);
+        EXPECT_EQ(ss.str(), "compose: |a -> b, c -> a| -> (c -> b), inc2: Int -> Int");
+
+        EXPECT_EQ(env.scheme(0).quantifiers, 3u);
+        EXPECT_EQ(env.scheme(1).quantifiers, 0u);
+
+        typ::Type* f = instantiate(arena, env.scheme(0), 0);
+        typ::Type* g = instantiate(arena, env.scheme(0), 0);
+        EXPECT_NE(f, g);
+        EXPECT_TRUE(unify(arena, f, g));
+    }
+
+    // A damaged file is never loaded
+    std::string contents;
+    {
+        std::ifstream in(path, std::ios::binary);
+        contents.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+
+    std::ofstream(path, std::ios::binary).write(contents.data(), contents.size() - 1);
+    EXPECT_FALSE(Interface(path).matches(hashSource(program)));
+
+    contents[contents.size() - 20] = char(0xff);
+    std::ofstream(path, std::ios::binary).write(contents.data(), contents.size());
+
+    typ::TypeArena arena;
+    typ::TypeEnvironment env;
+    EXPECT_THROW(Interface(path).load(arena, env), std::runtime_error);
+    EXPECT_EQ(env.size(), 0);
+
+    std::remove(path.c_str());
 }
 
 int main(int argc, char** argv)
@@ -0,0 +1,50 @@
+#include "thread_pool.hpp"
+#include <gtest/gtest.h>
+#include <atomic>
+
+TEST(ThreadPoolTest, RunsAllTasks)
+{
+    std::atomic<int> count{0};
+
+    ThreadPool pool(4);
+    for (int i = 0; i < 100; ++i)
+    {
+        // Tasks may submit further tasks
+        pool.submit([&] {
+            ++count;
+            pool.submit([&] { ++count; });
+        });
+    }
+
+    pool.wait();
+    EXPECT_EQ(count, 200);
+
+    // The pool can be reused after waiting
+    pool.submit([&] { ++count; });
+    pool.wait();
+    EXPECT_EQ(count, 201);
+}
+
+TEST(ThreadPoolTest, WaitsForNestedTasks)
+{
+    ThreadPool pool(4);
+    for (int round = 0; round < 200; ++round)
+    {
+        std::atomic<int> count{0};
+        for (int i = 0; i < 8; ++i)
+        {
+            // Children are queued on this worker, but may be stolen and
+            // finished by another before submit returns
+            pool.submit([&] {
+                for (int j = 0; j < 4; ++j)
+                {
+                    pool.submit([&] { ++count; });
+                }
+                ++count;
+            });
+        }
+
+        pool.wait();
+        ASSERT_EQ(count, 40) << "round " << round;
+    }
+}
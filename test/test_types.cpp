@@ -0,0 +1,338 @@
+#include "arena.hpp"
+#include "type_store.hpp"
+#include "types.hpp"
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <sstream>
+
+// Int -> (Int -> (... -> Int)) with the given number of arrows
+std::string repeatArrow(const std::string& input, int count)
+{
+    std::string result;
+    for (int i = 1; i < count; ++i)
+    {
+        result += input + " -> (";
+    }
+
+    result += input + " -> " + input;
+    result += std::string(count - 1, ')');
+
+    return result;
+}
+
+TEST(ArenaTest, Allocation)
+{
+    Arena arena;
+    EXPECT_EQ(arena.blockCount(), 0u);
+
+    // Small objects are packed into a single block, respecting alignment
+    for (int i = 0; i < 1000; ++i)
+    {
+        char* c = arena.make<char>('x');
+        double* d = arena.make<double>(1.0);
+        EXPECT_EQ(*c, 'x');
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(d) % alignof(double), 0u);
+    }
+    EXPECT_EQ(arena.blockCount(), 1u);
+
+    // Large arrays get a block of their own
+    Span<int> array = arena.makeArray<int>(100000);
+    EXPECT_EQ(array.size(), 100000u);
+    EXPECT_EQ(arena.blockCount(), 2u);
+}
+
+TEST(ArenaTest, TypeArena)
+{
+    typ::TypeArena types;
+
+    typ::Type* Int = types.makeConstant(std::string("Int"));
+    typ::Var* a = types.makeUnbound(0);
+    typ::Type* arrow = types.makeArrow({Int, a}, a);
+
+    std::stringstream ss;
+    ss << arrow;
+    EXPECT_EQ(ss.str(), "|Int, a| -> a");
+}
+
+TEST(TypesTest, Interning)
+{
+    typ::TypeArena types;
+
+    typ::Type* Int = types.makeConstant("Int");
+    typ::Type* Bool = types.makeConstant("Bool");
+    EXPECT_EQ(types.makeConstant(std::string("Int")), Int);
+
+    // Ground arrows are shared, arrows containing variables are not
+    typ::Type* f = types.makeArrow({Int, Bool}, Int);
+    EXPECT_EQ(types.makeArrow({Int, Bool}, Int), f);
+    EXPECT_NE(types.makeArrow({Bool, Int}, Int), f);
+
+    typ::Var* a = types.makeUnbound(0);
+    EXPECT_NE(types.makeArrow({a}, Int), types.makeArrow({a}, Int));
+
+    // Once a variable is bound to a ground type, arrows built from it are interned too
+    EXPECT_TRUE(unify(types, a, Int));
+    EXPECT_EQ(types.makeArrow({a, Bool}, a), f);
+}
+
+TEST(TypeStoreTest, Inference)
+{
+    typ::TypeStore store;
+
+    typ::TypeId Int = store.makeConstant("Int");
+    typ::TypeId Bool = store.makeConstant("Bool");
+    EXPECT_EQ(store.makeConstant("Int"), Int);
+
+    // id : a -> a, generalized and instantiated twice
+    typ::TypeId a = store.makeUnbound(1);
+    typ::TypeId id = store.generalize(store.makeArrow({a}, a), 0);
+
+    typ::TypeId f = store.instantiate(id, 0);
+    typ::TypeId g = store.instantiate(id, 0);
+    EXPECT_TRUE(store.unify(f, store.makeArrow({Int}, store.makeUnbound(0))));
+    EXPECT_TRUE(store.unify(g, store.makeArrow({Bool}, store.makeUnbound(0))));
+
+    std::stringstream ss;
+    store.print(ss, f);
+    ss << ", ";
+    store.print(ss, g);
+    ss << ", ";
+    store.print(ss, id);
+    EXPECT_EQ(ss.str(), "Int -> Int, Bool -> Bool, a -> a");
+
+    // Type errors
+    EXPECT_FALSE(store.unify(f, g));
+
+    typ::TypeId b = store.makeUnbound(0);
+    EXPECT_FALSE(store.unify(b, store.makeArrow({b}, Int)));
+}
+
+TEST(TypeStoreTest, DeepGeneralization)
+{
+    // Deeper than the traversal's inline stack, so that it grows midway
+    const int depth = 300;
+
+    typ::TypeStore store;
+    typ::TypeId Bool = store.makeConstant("Bool");
+
+    // Bool -> (Bool -> (... -> a))
+    typ::TypeId type = store.makeUnbound(1);
+    for (int i = 0; i < depth; ++i)
+    {
+        type = store.makeArrow({Bool}, type);
+    }
+
+    std::string expected = "a";
+    for (int i = 0; i < depth; ++i)
+    {
+        expected = "Bool -> " + (i ? "(" + expected + ")" : expected);
+    }
+
+    typ::TypeId generalized = store.generalize(type, 0);
+    typ::TypeId instance = store.instantiate(generalized, 0);
+
+    std::stringstream ss;
+    store.print(ss, generalized);
+    EXPECT_EQ(ss.str(), expected);
+
+    ss.str("");
+    store.print(ss, instance);
+    EXPECT_EQ(ss.str(), expected);
+}
+
+TEST(TypesTest, StructureSharing)
+{
+    typ::TypeArena types;
+
+    typ::Type* Int = types.makeConstant("Int");
+    typ::Var* a = types.makeUnbound(0);
+    typ::Var* b = types.makeUnbound(1);
+
+    // a is from an outer level, so this subtree is left alone by generalization
+    typ::Type* outer = types.makeArrow({a, Int}, a);
+    typ::Type* type = types.makeArrow({outer, b}, b);
+    typ::TypeScheme generalized = generalize(types, type, 0);
+
+    ASSERT_NE(generalized.type, type);
+    ASSERT_EQ(generalized.type->tag(), typ::kArrow);
+    EXPECT_EQ(static_cast<typ::Arrow*>(generalized.type)->inputs[0], outer);
+    EXPECT_EQ(generalized.quantifiers, 1u);
+
+    // ... and contains no generic variables, so instantiation shares it as well
+    typ::Type* instance = instantiate(types, generalized, 0);
+    EXPECT_EQ(static_cast<typ::Arrow*>(instance)->inputs[0], outer);
+
+    // A monomorphic scheme is its own instance
+    typ::TypeScheme monomorphic = generalize(types, outer, 0);
+    EXPECT_EQ(monomorphic.type, outer);
+    EXPECT_EQ(monomorphic.quantifiers, 0u);
+    EXPECT_EQ(instantiate(types, monomorphic, 0), outer);
+}
+
+TEST(TypesTest, UnionByRank)
+{
+    typ::TypeArena types;
+
+    typ::Var* a = types.makeUnbound(2);
+    typ::Var* b = types.makeUnbound(2);
+    typ::Var* c = types.makeUnbound(0);
+    typ::Var* d = types.makeUnbound(1);
+
+    // Equal ranks: lhs is linked to rhs, whose rank grows
+    ASSERT_TRUE(unify(types, a, b));
+    EXPECT_EQ(a->root(), b);
+    EXPECT_EQ(b->rank, 1u);
+
+    // The smaller class is linked below the larger, whichever side it is on,
+    // and the root takes the outermost level
+    ASSERT_TRUE(unify(types, c, a));
+    ASSERT_TRUE(unify(types, b, d));
+    EXPECT_EQ(c->root(), b);
+    EXPECT_EQ(d->root(), b);
+    EXPECT_EQ(b->level, 0);
+    EXPECT_EQ(b->rank, 1u);
+
+    // Generalization sees the merged level
+    EXPECT_EQ(generalize(types, a, 0).type, b);
+}
+
+TEST(TypesTest, DeferredChecks)
+{
+    typ::TypeArena types;
+    typ::Type* Int = types.makeConstant("Int");
+
+    // Binding leaves the variables inside the arrow alone...
+    typ::Var* a = types.makeUnbound(2);
+    typ::Type* arrow = types.makeArrow({a}, Int);
+    ASSERT_TRUE(unify(types, types.makeUnbound(0), arrow));
+    EXPECT_EQ(a->level, 2);
+
+    // ...until generalization needs their levels
+    EXPECT_EQ(generalize(types, arrow, 1).type, arrow);
+    EXPECT_EQ(a->level, 0);
+
+    // Cycles through an arrow being unified are caught at once
+    typ::Var* b = types.makeUnbound(0);
+    typ::Type* inner = types.makeArrow({b}, Int);
+    EXPECT_FALSE(unify(types, inner, types.makeArrow({inner}, Int)));
+
+    // Other cycles are caught by the next check
+    typ::Var* c = types.makeUnbound(0);
+    ASSERT_TRUE(unify(types, c, types.makeArrow({c}, Int)));
+    EXPECT_EQ(generalize(types, c, -1).type, nullptr);
+    EXPECT_FALSE(checkCycles(types));
+}
+
+TEST(TypesTest, AlphaEquivalence)
+{
+    typ::TypeArena types;
+    typ::TypeArena other;
+    typ::Type* Int = types.makeConstant("Int");
+    typ::Var* a = types.makeUnbound(0);
+    typ::Var* b = types.makeUnbound(0);
+
+    // |a, b| -> a, from another arena and with other variables
+    typ::Type* first = types.makeArrow({a, b}, a);
+    typ::Var* c = other.makeUnbound(0);
+    typ::Type* renamed = other.makeArrow({c, other.makeUnbound(0)}, c);
+    EXPECT_TRUE(alphaEquivalent(first, renamed));
+    EXPECT_EQ(hashType(first), hashType(renamed));
+
+    // Generic and unbound variables are alike
+    typ::Type* generalized = generalize(types, types.makeArrow({types.makeUnbound(1), b}, b), 0).type;
+    EXPECT_TRUE(alphaEquivalent(types.makeArrow({a, b}, b), generalized));
+    EXPECT_EQ(hashType(types.makeArrow({a, b}, b)), hashType(generalized));
+
+    // Even in one type, where a generic variable may share its index with an
+    // unbound one: a -> b, with a generic and b not
+    typ::TypeArena mixed;
+    typ::Var* x = mixed.makeUnbound(0);
+    typ::Var* y = mixed.makeUnbound(1);
+    typ::Type* partial = generalize(mixed, mixed.makeArrow({y}, x), 0).type;
+    typ::Var* u = other.makeUnbound(0);
+    std::stringstream ss;
+    ss << partial;
+    EXPECT_EQ(ss.str(), "a -> b");
+    EXPECT_TRUE(alphaEquivalent(partial, other.makeArrow({other.makeUnbound(0)}, u)));
+    EXPECT_FALSE(alphaEquivalent(partial, other.makeArrow({u}, u)));
+    EXPECT_NE(hashType(partial), hashType(other.makeArrow({u}, u)));
+
+    // Renaming must be consistent: |a, b| -> b and |a, a| -> a differ from it
+    typ::Type* second = types.makeArrow({a, b}, b);
+    typ::Type* same = types.makeArrow({a, a}, a);
+    EXPECT_FALSE(alphaEquivalent(first, second));
+    EXPECT_FALSE(alphaEquivalent(first, same));
+    EXPECT_FALSE(alphaEquivalent(same, first));
+    EXPECT_NE(hashType(first), hashType(second));
+    EXPECT_NE(hashType(first), hashType(same));
+
+    // Constants are compared by name, and bound variables by their values
+    EXPECT_TRUE(alphaEquivalent(Int, other.makeConstant("Int")));
+    EXPECT_FALSE(alphaEquivalent(Int, other.makeConstant("Bool")));
+    ASSERT_TRUE(unify(types, b, Int));
+    EXPECT_TRUE(alphaEquivalent(first, other.makeArrow({c, other.makeConstant("Int")}, c)));
+    EXPECT_FALSE(alphaEquivalent(first, renamed));
+
+    // Many variables
+    const int count = 100;
+    Span<typ::Type*> inputs = types.makeInputs(count);
+    Span<typ::Type*> reversed = other.makeInputs(count);
+    for (int i = 0; i < count; ++i)
+    {
+        inputs[i] = types.makeUnbound(0);
+    }
+    for (int i = count; i > 0; --i)
+    {
+        reversed[i - 1] = other.makeUnbound(0);
+    }
+
+    typ::Type* wide = types.makeArrow(inputs, inputs[count - 1]);
+    EXPECT_TRUE(alphaEquivalent(wide, other.makeArrow(reversed, reversed[count - 1])));
+    EXPECT_FALSE(alphaEquivalent(wide, other.makeArrow(reversed, reversed[0])));
+    EXPECT_EQ(hashType(wide), hashType(other.makeArrow(reversed, reversed[count - 1])));
+}
+
+// Far deeper than the native stack would allow if the primitives recursed
+TEST(TypesTest, DeepTypes)
+{
+    const int depth = 200000;
+
+    typ::TypeArena types;
+    typ::Type* Int = types.makeConstant("Int");
+
+    // a -> (a -> (... -> Int))
+    typ::Var* a = types.makeUnbound(1);
+    typ::Type* type = Int;
+    for (int i = 0; i < depth; ++i)
+    {
+        type = types.makeArrow({a}, type);
+    }
+
+    typ::TypeScheme generalized = generalize(types, type, 0);
+    EXPECT_EQ(generalized.quantifiers, 1u);
+
+    typ::Type* instance = instantiate(types, generalized, 0);
+    typ::Type* other = instantiate(types, generalized, 0);
+    EXPECT_TRUE(alphaEquivalent(instance, generalized.type));
+    EXPECT_EQ(hashType(instance), hashType(generalized.type));
+    ASSERT_TRUE(unify(types, instance, other));
+
+    EXPECT_FALSE(occurs(types.makeUnbound(0), 0, instance));
+    ASSERT_TRUE(unify(types, instance, types.makeArrow({Int}, types.makeUnbound(0))));
+
+    std::stringstream ss;
+    ss << other;
+    EXPECT_EQ(ss.str(), repeatArrow("Int", depth));
+
+    typ::TypeStore store;
+    typ::TypeId storeInt = store.makeConstant("Int");
+    typ::TypeId storeType = storeInt;
+    typ::TypeId b = store.makeUnbound(1);
+    for (int i = 0; i < depth; ++i)
+    {
+        storeType = store.makeArrow({b}, storeType);
+    }
+
+    typ::TypeId storeGeneralized = store.generalize(storeType, 0);
+    EXPECT_TRUE(store.unify(store.instantiate(storeGeneralized, 0), store.instantiate(storeGeneralized, 0)));
+}
@@ -0,0 +1,139 @@
+#include "thread_pool.hpp"
+#include <algorithm>
+
+// Identifies the pool and queue of the current worker thread, if any
+static thread_local ThreadPool* t_pool = nullptr;
+static thread_local unsigned t_index = 0;
+
+ThreadPool::ThreadPool(unsigned threads)
+{
+    if (threads == 0)
+    {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    for (unsigned i = 0; i < threads; ++i)
+    {
+        _queues.emplace_back(new Queue);
+    }
+
+    for (unsigned i = 0; i < threads; ++i)
+    {
+        _threads.emplace_back([this, i] { run(i); });
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    wait();
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = true;
+    }
+    _wake.notify_all();
+
+    for (auto& thread : _threads)
+    {
+        thread.join();
+    }
+}
+
+void ThreadPool::submit(std::function<void()> task)
+{
+    unsigned index = t_index;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (t_pool != this)
+        {
+            index = _nextQueue;
+            _nextQueue = (_nextQueue + 1) % _queues.size();
+        }
+
+        // Counted before it is queued: once queued, another worker may take
+        // and finish it straight away
+        ++_queued;
+        ++_pending;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(_queues[index]->mutex);
+        _queues[index]->tasks.push_back(std::move(task));
+    }
+    _wake.notify_one();
+}
+
+void ThreadPool::wait()
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    _idle.wait(lock, [this] { return _pending == 0; });
+}
+
+// Takes the newest task from the worker's own queue, or else the oldest task
+// from any other queue
+bool ThreadPool::pop(unsigned index, std::function<void()>& task)
+{
+    {
+        Queue& queue = *_queues[index];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.tasks.empty())
+        {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+            return true;
+        }
+    }
+
+    for (size_t i = 1; i < _queues.size(); ++i)
+    {
+        Queue& queue = *_queues[(index + i) % _queues.size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.tasks.empty())
+        {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void ThreadPool::run(unsigned index)
+{
+    t_pool = this;
+    t_index = index;
+
+    std::function<void()> task;
+    while (true)
+    {
+        if (pop(index, task))
+        {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                --_queued;
+            }
+
+            task();
+            task = nullptr;
+
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (--_pending == 0)
+            {
+                _idle.notify_all();
+            }
+        }
+        else
+        {
+            // Sleep until there is something to steal. A task counted but not
+            // yet queued only means trying again.
+            std::unique_lock<std::mutex> lock(_mutex);
+            _wake.wait(lock, [this] { return _stopping || _queued > 0; });
+
+            if (_stopping && _queued == 0)
+            {
+                return;
+            }
+        }
+    }
+}
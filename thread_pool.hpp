@@ -0,0 +1,59 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed-size pool of worker threads with work stealing: each worker has its own
+// queue, runs its newest task first, and takes the oldest task from another
+// worker's queue when its own runs dry.
+//
+// Tasks must not throw.
+class ThreadPool
+{
+public:
+    // Zero means one worker per hardware thread
+    explicit ThreadPool(unsigned threads = 0);
+
+    // Finishes all submitted tasks before returning
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Tasks submitted from a worker go to that worker's own queue, others are
+    // spread over the workers round-robin
+    void submit(std::function<void()> task);
+
+    // Blocks until every submitted task (including ones submitted by other
+    // tasks in the meantime) has finished
+    void wait();
+
+    unsigned size() const { return _threads.size(); }
+
+private:
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    void run(unsigned index);
+    bool pop(unsigned index, std::function<void()>& task);
+
+    std::vector<std::unique_ptr<Queue>> _queues;
+    std::vector<std::thread> _threads;
+    unsigned _nextQueue = 0;
+
+    // Protects the counters below
+    std::mutex _mutex;
+    std::condition_variable _wake;
+    std::condition_variable _idle;
+
+    size_t _queued = 0;  // waiting in some queue
+    size_t _pending = 0; // submitted but not yet finished
+    bool _stopping = false;
+};
@@ -1,6 +1,6 @@
 #pragma once
 #include <iostream>
-#include <string>
+#include <string_view>
 
 struct Token
 {
@@ -23,5 +23,7 @@ struct Token
     };
 
     TokenType type;
-    std::string lexeme;
+
+    // Points into the source text
+    std::string_view lexeme;
 };
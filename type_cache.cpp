@@ -0,0 +1,29 @@
+#include "type_cache.hpp"
+#include <cassert>
+
+namespace typ
+{
+
+TypeScheme TypeCache::find(uint64_t key, uint32_t nodes, TypeArena& arena)
+{
+    auto i = _entries.find(key);
+    if (i == _entries.end() || i->second.nodes != nodes)
+    {
+        ++_counts.misses;
+        return {nullptr, 0};
+    }
+
+    ++_counts.hits;
+    _counts.nodesSkipped += i->second.nodes;
+
+    const TypeScheme& scheme = i->second.scheme;
+    return {copy(arena, scheme.type), scheme.quantifiers};
+}
+
+void TypeCache::insert(uint64_t key, TypeScheme scheme, uint32_t nodes)
+{
+    assert(isClosed(scheme.type));
+    _entries[key] = Entry{{copy(_types, scheme.type), scheme.quantifiers}, nodes};
+}
+
+} // namespace typ
@@ -0,0 +1,58 @@
+#pragma once
+#include "types.hpp"
+#include <cstdint>
+#include <unordered_map>
+
+namespace typ
+{
+
+// Type schemes of let-bound values, kept across analyses so that an
+// edited program only re-infers the bindings which actually changed
+//
+// Entries are keyed by the fingerprint of the value (see Fingerprinter), which
+// covers both its source and everything it refers to, and also record the
+// value's size, so that a fingerprint collision between values of different
+// sizes is a miss rather than a wrong type. Only closed types are
+// cached: they are copied into the cache's own arena, and copied back out into
+// the arena of each analysis that reuses them.
+//
+// Not thread-safe: use one cache per sequence of edits.
+class TypeCache
+{
+public:
+    // How much work has been saved so far
+    struct Counts
+    {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t nodesSkipped = 0; // AST nodes in the values which were reused
+    };
+
+    // Returns a copy of the scheme cached for key and a value of the given
+    // size in the given arena, or one with a null type
+    TypeScheme find(uint64_t key, uint32_t nodes, TypeArena& arena);
+
+    // Caches a closed scheme, and the size of the value it was inferred from
+    void insert(uint64_t key, TypeScheme scheme, uint32_t nodes);
+
+    // Entries are never evicted, since types cannot be freed individually
+    // from the cache's arena. Replace the cache to release them.
+    size_t size() const { return _entries.size(); }
+
+    const Counts& counts() const { return _counts; }
+    void resetCounts() { _counts = Counts(); }
+
+private:
+    struct Entry
+    {
+        TypeScheme scheme;
+        uint32_t nodes;
+    };
+
+    TypeArena _types;
+    std::unordered_map<uint64_t, Entry> _entries;
+
+    Counts _counts;
+};
+
+} // namespace typ
@@ -8,38 +8,54 @@ TypeEnvironment::TypeEnvironment()
     enterScope();
 }
 
-Type* TypeEnvironment::lookup(const std::string& ident)
+TypeEnvironment::TypeEnvironment(const TypeEnvironment* base)
+: _base(base), _baseSize(base->size())
 {
-    for (auto itr = _scopes.rbegin(); itr != _scopes.rend(); ++itr)
+    enterScope();
+}
+
+Type* TypeEnvironment::lookup(std::string_view ident) const
+{
+    HM_COUNT(lookups, 1);
+
+    for (auto itr = _bindings.rbegin(); itr != _bindings.rend(); ++itr)
     {
-        auto& scope = *itr;
-        auto i = scope.find(ident);
-        if (i != scope.end())
+        if (itr->name == ident)
         {
-            return i->second;
+            return itr->scheme.type;
         }
     }
 
-    return nullptr;
+    return _base ? _base->lookup(ident) : nullptr;
 }
 
-bool TypeEnvironment::checkScope(const std::string& ident)
+bool TypeEnvironment::checkScope(std::string_view ident)
 {
-    return _scopes.back().count(ident) != 0;
+    for (size_t i = _scopes.back(); i < _bindings.size(); ++i)
+    {
+        if (_bindings[i].name == ident)
+        {
+            return true;
+        }
+    }
+
+    return false;
 }
 
-void TypeEnvironment::insert(const std::string& ident, Type* type)
+void TypeEnvironment::insert(std::string_view ident, TypeScheme scheme)
 {
-    _scopes.back()[ident] = type;
+    _bindings.push_back({ident, scheme});
 }
 
 void TypeEnvironment::enterScope()
 {
-    _scopes.push_back({});
+    _scopes.push_back(_bindings.size());
+    HM_MAX(maxScopeDepth, _scopes.size());
 }
 
 void TypeEnvironment::exitScope()
 {
+    _bindings.resize(_scopes.back());
     _scopes.pop_back();
 }
 
@@ -1,31 +1,78 @@
 #pragma once
+#include "stats.hpp"
 #include "types.hpp"
 #include <string>
-#include <unordered_map>
+#include <string_view>
+#include <vector>
 
 namespace typ
 {
 
-// A lexically-scoped assignment of types to identifiers
+// A lexically-scoped assignment of type schemes to identifiers
+//
+// Bindings form a single stack, and each binding is identified by its position
+// (slot) in that stack. Names are not copied, so they must outlive the binding.
+//
+// An environment may extend a frozen base, whose bindings take the lowest slots
+// and form an outermost scope which is shared rather than copied.
 class TypeEnvironment
 {
 public:
     TypeEnvironment();
 
+    // The base must outlive this environment, and must no longer change
+    explicit TypeEnvironment(const TypeEnvironment* base);
+
     // Searches all scopes - returns nullptr if not found
-    Type* lookup(const std::string& ident);
+    Type* lookup(std::string_view ident) const;
+
+    // Constant-time lookup of a slot assigned by the Resolver
+    TypeScheme lookup(int slot)
+    {
+        HM_COUNT(lookups, 1);
+        return binding(slot).scheme;
+    }
 
     // Does not check that the identifier is undefined in the current scope
-    void insert(const std::string& ident, Type* type);
+    void insert(std::string_view ident, TypeScheme scheme);
+
+    // Binds a monomorphic type (with no generic variables)
+    void insert(std::string_view ident, Type* type) { insert(ident, TypeScheme{type, 0}); }
 
     // Is this identifier already defined in the current scope?
-    bool checkScope(const std::string& ident);
+    bool checkScope(std::string_view ident);
 
     void enterScope();
     void exitScope();
 
+    // Number of open scopes
+    size_t depth() const { return _scopes.size(); }
+
+    // Number of bindings in all scopes, and the name and scheme bound in each slot
+    int size() const { return _baseSize + _bindings.size(); }
+    std::string_view name(int slot) const { return binding(slot).name; }
+    TypeScheme scheme(int slot) const { return binding(slot).scheme; }
+    Type* type(int slot) const { return binding(slot).scheme.type; }
+
 private:
-    std::vector<std::unordered_map<std::string, Type*>> _scopes;
+    struct Binding
+    {
+        std::string_view name;
+        TypeScheme scheme;
+    };
+
+    const Binding& binding(int slot) const
+    {
+        return slot < _baseSize ? _base->binding(slot) : _bindings[slot - _baseSize];
+    }
+
+    const TypeEnvironment* _base = nullptr;
+    int _baseSize = 0;
+
+    std::vector<Binding> _bindings;
+
+    // Number of bindings below each open scope
+    std::vector<size_t> _scopes;
 };
 
 } // namespace typ
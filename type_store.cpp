@@ -0,0 +1,434 @@
+#include "type_store.hpp"
+#include "work_stack.hpp"
+#include <algorithm>
+#include <cassert>
+#include <functional>
+
+namespace typ
+{
+
+TypeId TypeStore::add(Tag tag, uint32_t data, uint32_t extra, int level)
+{
+    TypeId id = _tags.size();
+    _tags.push_back(tag);
+    _data.push_back(data);
+    _extra.push_back(extra);
+    _levels.push_back(level);
+    return id;
+}
+
+TypeId TypeStore::makeConstant(std::string_view name)
+{
+    std::string key(name);
+
+    auto i = _constants.find(key);
+    if (i != _constants.end())
+    {
+        return i->second;
+    }
+
+    TypeId id = add(kConstant, _names.size(), 0, 0);
+    _names.push_back(key);
+    _constants.emplace(key, id);
+
+    return id;
+}
+
+TypeId TypeStore::makeArrow(const TypeId* inputs, size_t count, TypeId output)
+{
+    // Growing _args would move inputs stored in it
+    std::less<const TypeId*> before;
+    assert(!before(inputs, _args.data() + _args.size()) || !before(_args.data(), inputs + count));
+
+    uint32_t offset = _args.size();
+    _args.insert(_args.end(), inputs, inputs + count);
+    _args.push_back(output);
+
+    return add(kArrow, offset, count, 0);
+}
+
+TypeId TypeStore::makeArrow(std::initializer_list<TypeId> inputs, TypeId output)
+{
+    return makeArrow(inputs.begin(), inputs.size(), output);
+}
+
+TypeId TypeStore::makeUnbound(int level)
+{
+    return add(kVar, kNoType, 0, level);
+}
+
+TypeId TypeStore::makeGeneric(uint32_t index)
+{
+    return add(kVar, kNoType, index, -1);
+}
+
+TypeId TypeStore::root(TypeId type)
+{
+    // Find the root of the chain
+    TypeId root = type;
+    while (_tags[root] == kVar && _data[root] != kNoType)
+    {
+        root = _data[root];
+    }
+
+    // Path compression: point every link in the chain directly to the root
+    while (type != root && _data[type] != root)
+    {
+        TypeId next = _data[type];
+        _data[type] = root;
+        type = next;
+    }
+
+    return root;
+}
+
+bool TypeStore::occurs(TypeId var, int level, TypeId type)
+{
+    WorkStack<TypeId> stack;
+    stack.push(type);
+
+    while (!stack.empty())
+    {
+        type = root(stack.pop());
+
+        switch (tag(type))
+        {
+            // Type constants contain no type variables
+            case kConstant:
+                break;
+
+            // Search the components of arrow types (output first)
+            case kArrow:
+            {
+                for (uint32_t i = arity(type); i > 0; --i)
+                {
+                    stack.push(input(type, i - 1));
+                }
+                stack.push(output(type));
+
+                break;
+            }
+
+            case kVar:
+            {
+                assert(!isGeneric(type));
+
+                // Found a match
+                if (type == var)
+                {
+                    return true;
+                }
+
+                // We're going to bind var to type, so type's level moves up to var's
+                _levels[type] = std::min(level, _levels[type]);
+
+                break;
+            }
+
+            default:
+                assert(false);
+        }
+    }
+
+    return false;
+}
+
+bool TypeStore::bind(TypeId var, TypeId type)
+{
+    type = root(type);
+    assert(tag(var) == kVar && link(var) == kNoType && !isGeneric(var));
+
+    // If the variable appeared in the type, then the assignment would yield
+    // an infinite, recursive type
+    if (occurs(var, _levels[var], type))
+    {
+        return false;
+    }
+
+    _data[var] = type;
+    return true;
+}
+
+// Copies a type bottom-up, replacing each type variable with mapVar(var).
+// The argument slots of each new arrow are reserved before its components are
+// visited, because nested arrows append to the same array. Components are
+// visited inputs first, then the output.
+template <typename MapVar>
+TypeId TypeStore::mapType(TypeId type, MapVar mapVar)
+{
+    // An arrow being copied: its next component, and where its copy's
+    // arguments are stored
+    struct Frame
+    {
+        TypeId arrow;
+        uint32_t next;
+        uint32_t offset;
+    };
+
+    WorkStack<Frame> frames;
+    TypeId result = kNoType;
+
+    auto visit = [&](TypeId type) {
+        type = root(type);
+
+        switch (tag(type))
+        {
+            case kConstant:
+                result = type;
+                break;
+
+            case kArrow:
+            {
+                uint32_t offset = _args.size();
+                _args.resize(offset + arity(type) + 1);
+                frames.push({type, 0, offset});
+                break;
+            }
+
+            case kVar:
+                result = mapVar(type);
+                break;
+
+            default:
+                assert(false);
+        }
+    };
+
+    visit(type);
+    while (!frames.empty())
+    {
+        Frame& frame = frames.top();
+
+        // Store the component which has just been completed
+        if (result != kNoType)
+        {
+            _args[frame.offset + frame.next - 1] = result;
+            result = kNoType;
+        }
+
+        if (frame.next < arity(frame.arrow))
+        {
+            visit(input(frame.arrow, frame.next++));
+        }
+        else if (frame.next == arity(frame.arrow))
+        {
+            // visit may grow the stack, so frame must not be used after it
+            TypeId out = output(frame.arrow);
+            ++frame.next;
+            visit(out);
+        }
+        else
+        {
+            Frame done = frames.pop();
+            result = add(kArrow, done.offset, arity(done.arrow), 0);
+        }
+    }
+
+    return result;
+}
+
+TypeId TypeStore::generalize(TypeId type, int level)
+{
+    return mapType(type, [&](TypeId var) {
+        // Unbound variables are generalized only if they are from a deeper
+        // level. Generic type variables are unchanged.
+        if (!isGeneric(var) && _levels[var] > level)
+        {
+            return makeGeneric(var);
+        }
+
+        return var;
+    });
+}
+
+TypeId TypeStore::instantiate(TypeId type, int level)
+{
+    // Generic variables are replaced with fresh unbound ones. There are usually
+    // only a handful, so a linear search beats hashing.
+    std::vector<std::pair<uint32_t, TypeId>> replaced;
+
+    return mapType(type, [&](TypeId var) {
+        // Unbound variables are unchanged
+        if (!isGeneric(var))
+        {
+            return var;
+        }
+
+        uint32_t generic = index(var);
+        for (auto& entry : replaced)
+        {
+            if (entry.first == generic)
+            {
+                return entry.second;
+            }
+        }
+
+        TypeId fresh = makeUnbound(level);
+        replaced.emplace_back(generic, fresh);
+
+        return fresh;
+    });
+}
+
+bool TypeStore::unify(TypeId lhs, TypeId rhs)
+{
+    // Pairs of arrows being unified, and the next pair of components to unify
+    // (output first, then the inputs)
+    struct Frame
+    {
+        TypeId lhs;
+        TypeId rhs;
+        uint32_t next;
+    };
+
+    WorkStack<Frame> stack;
+
+    // Unifies the roots of a single pair of types, deferring the components of
+    // arrows to the stack. Returns false if they cannot be unified.
+    auto step = [&](TypeId lhs, TypeId rhs) {
+        lhs = root(lhs);
+        rhs = root(rhs);
+
+        // Identical types (including interned constants) trivially unify
+        if (lhs == rhs)
+        {
+            return true;
+        }
+
+        Tag lhsTag = tag(lhs);
+        Tag rhsTag = tag(rhs);
+
+        // Distinct constants are distinct types
+        if (lhsTag == kConstant && rhsTag == kConstant)
+        {
+            return false;
+        }
+        // Arrow types: components must unify
+        else if (lhsTag == kArrow && rhsTag == kArrow)
+        {
+            if (arity(lhs) != arity(rhs))
+            {
+                return false;
+            }
+
+            stack.push({lhs, rhs, 0});
+            return true;
+        }
+        // Unifying an unbound variable binds the variable to the other type
+        else if (lhsTag == kVar && !isGeneric(lhs))
+        {
+            return bind(lhs, rhs);
+        }
+        else if (rhsTag == kVar && !isGeneric(rhs))
+        {
+            return bind(rhs, lhs);
+        }
+
+        return false;
+    };
+
+    if (!step(lhs, rhs))
+    {
+        return false;
+    }
+
+    while (!stack.empty())
+    {
+        Frame& frame = stack.top();
+
+        if (frame.next > arity(frame.lhs))
+        {
+            stack.pop();
+            continue;
+        }
+
+        // Copied out, since step may push onto the stack and move frame
+        uint32_t i = frame.next++;
+        TypeId left = i == 0 ? output(frame.lhs) : input(frame.lhs, i - 1);
+        TypeId right = i == 0 ? output(frame.rhs) : input(frame.rhs, i - 1);
+
+        if (!step(left, right))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void TypeStore::print(std::ostream& out, TypeId type)
+{
+    // Refer to type variables by sequential lowercase characters as encountered
+    std::vector<uint32_t> varNames;
+
+    // Output still to be written: either a type or a piece of punctuation
+    struct Item
+    {
+        TypeId type;
+        const char* text;
+    };
+
+    WorkStack<Item> stack;
+    stack.push({type, nullptr});
+
+    while (!stack.empty())
+    {
+        Item item = stack.pop();
+        if (item.text)
+        {
+            out << item.text;
+            continue;
+        }
+
+        type = root(item.type);
+        switch (tag(type))
+        {
+            case kConstant:
+                out << name(type);
+                break;
+
+            // Pieces of arrow types are pushed in reverse order of output
+            case kArrow:
+            {
+                uint32_t count = arity(type);
+
+                bool parens = tag(root(output(type))) == kArrow;
+                if (parens) stack.push({kNoType, ")"});
+                stack.push({output(type), nullptr});
+                if (parens) stack.push({kNoType, "("});
+
+                stack.push({kNoType, " -> "});
+
+                bool brackets = (count != 1) || tag(root(input(type, 0))) == kArrow;
+                if (brackets) stack.push({kNoType, "|"});
+                for (uint32_t i = count; i > 0; --i)
+                {
+                    stack.push({input(type, i - 1), nullptr});
+                    if (i != 1) stack.push({kNoType, ", "});
+                }
+                if (brackets) stack.push({kNoType, "|"});
+
+                break;
+            }
+
+            case kVar:
+            {
+                uint32_t var = index(type);
+                auto i = std::find(varNames.begin(), varNames.end(), var);
+                if (i == varNames.end())
+                {
+                    i = varNames.insert(varNames.end(), var);
+                }
+
+                out << char('a' + (i - varNames.begin()));
+
+                break;
+            }
+
+            default:
+                assert(false);
+        }
+    }
+}
+
+} // namespace typ
@@ -0,0 +1,95 @@
+#pragma once
+#include "types.hpp"
+#include <cstdint>
+#include <initializer_list>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace typ
+{
+
+// Types in a TypeStore are identified by dense 32-bit ids
+using TypeId = uint32_t;
+constexpr TypeId kNoType = UINT32_MAX;
+
+// Compact alternative to the Type class hierarchy: all types live in parallel
+// arrays indexed by TypeId, and are dispatched on with a plain tag byte instead
+// of virtual calls. The inputs and output of each arrow are stored contiguously
+// in a single shared array.
+//
+// Provides the same inference primitives as the free functions in types.hpp.
+class TypeStore
+{
+public:
+    // Constants are interned by name
+    TypeId makeConstant(std::string_view name);
+
+    // The inputs are copied, so must not point into this store
+    TypeId makeArrow(const TypeId* inputs, size_t count, TypeId output);
+    TypeId makeArrow(std::initializer_list<TypeId> inputs, TypeId output);
+
+    TypeId makeUnbound(int level);
+    TypeId makeGeneric(uint32_t index);
+
+    Tag tag(TypeId type) const { return Tag(_tags[type]); }
+
+    // Accessors for type constants
+    std::string_view name(TypeId constant) const { return _names[_data[constant]]; }
+
+    // Accessors for arrows
+    uint32_t arity(TypeId arrow) const { return _extra[arrow]; }
+    TypeId input(TypeId arrow, uint32_t i) const { return _args[_data[arrow] + i]; }
+    TypeId output(TypeId arrow) const { return _args[_data[arrow] + _extra[arrow]]; }
+
+    // Accessors for type variables. An unbound variable is identified by its
+    // own id, a generic one by its index.
+    TypeId link(TypeId var) const { return _data[var]; }
+    int level(TypeId var) const { return _levels[var]; }
+    bool isGeneric(TypeId var) const { return _levels[var] == -1; }
+    uint32_t index(TypeId var) const { return isGeneric(var) ? _extra[var] : var; }
+
+    // Follows (and compresses) chains of linked type variables
+    TypeId root(TypeId type);
+
+    bool occurs(TypeId var, int level, TypeId type);
+
+    // Returns false, binding nothing, if var occurs in type (an infinite type)
+    bool bind(TypeId var, TypeId type);
+
+    TypeId generalize(TypeId type, int level);
+    TypeId instantiate(TypeId type, int level);
+
+    // Returns false if no unifying assignment exists, or if it would make an
+    // infinite type (variables may have already been assigned)
+    bool unify(TypeId lhs, TypeId rhs);
+
+    void print(std::ostream& out, TypeId type);
+
+    size_t size() const { return _tags.size(); }
+
+private:
+    TypeId add(Tag tag, uint32_t data, uint32_t extra, int level);
+
+    template <typename MapVar>
+    TypeId mapType(TypeId type, MapVar mapVar);
+
+    // Per-type columns:
+    //   constant: data = name id
+    //   arrow:    data = offset into _args, extra = number of inputs
+    //   var:      data = link (or kNoType), extra = index (generic only), level
+    std::vector<uint8_t> _tags;
+    std::vector<uint32_t> _data;
+    std::vector<uint32_t> _extra;
+    std::vector<int> _levels;
+
+    // Inputs followed by the output, for every arrow
+    std::vector<TypeId> _args;
+
+    std::vector<std::string> _names;
+    std::unordered_map<std::string, TypeId> _constants;
+};
+
+} // namespace typ
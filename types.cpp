@@ -1,4 +1,8 @@
 #include "types.hpp"
+#include "hash.hpp"
+#include "stats.hpp"
+#include "work_stack.hpp"
+#include <algorithm>
 #include <cassert>
 #include <stdexcept>
 
@@ -9,371 +13,1259 @@
 namespace typ
 {
 
-int Var::s_nextIndex = 0;
-
 bool occurs(Var* lhs, int level, Type* rhs)
 {
-    rhs = rhs->root();
+    WorkStack<Type*> stack;
+    stack.push(rhs);
 
-    switch (rhs->tag())
+    while (!stack.empty())
     {
-        // Type constants contain no type variables
-        case kConstant:
-            return false;
+        HM_COUNT(occursNodes, 1);
+        Type* type = stack.pop()->root();
 
-        // Search recursively for arrow types
-        case kArrow:
+        // Ground types contain no type variables
+        if (isGround(type))
         {
-            Arrow* arrow = dynamic_cast<Arrow*>(rhs);
+            continue;
+        }
 
-            if (occurs(lhs, level, arrow->output))
-                return true;
+        switch (type->tag())
+        {
+            // Type constants contain no type variables
+            case kConstant:
+                break;
 
-            for (auto* input : arrow->inputs)
+            // Search the components of arrow types (output first)
+            case kArrow:
             {
-                if (occurs(lhs, level, input))
+                Arrow* arrow = static_cast<Arrow*>(type);
+
+                for (size_t i = arrow->inputs.size(); i > 0; --i)
+                {
+                    stack.push(arrow->inputs[i - 1]);
+                }
+                stack.push(arrow->output);
+
+                break;
+            }
+
+            case kVar:
+            {
+                Var* var = static_cast<Var*>(type);
+                assert(!var->link);
+                assert(!var->isGeneric());
+
+                // Found a match
+                if (var->index == lhs->index)
+                {
                     return true;
+                }
+
+                // We're going to bind lhs to var, so var's level moves up to lhs's
+                var->level = std::min(level, var->level);
+
+                break;
             }
 
-            return false;
+            default:
+                assert(false);
         }
+    }
 
-        case kVar:
+    return false;
+}
+
+// Requests that no variable in the arrow stays above the given level. The
+// arrow is queued for adjustLevels to pass it down to the variables.
+//
+// Returns false if the arrow is being unified, since the variable being bound
+// is then inside it (an infinite type).
+static bool lowerLevel(std::vector<Arrow*>& queue, Arrow* arrow, int level)
+{
+    if (arrow->ground)
+    {
+        return true;
+    }
+
+    if (arrow->marked)
+    {
+        return false;
+    }
+
+    if (level < arrow->pendingLevel)
+    {
+        arrow->pendingLevel = level;
+
+        if (!arrow->queued)
         {
-            Var* var = dynamic_cast<Var*>(rhs);
-            assert(!var->link);
-            assert(!var->isGeneric());
+            arrow->queued = true;
+            queue.push_back(arrow);
+        }
+    }
 
-            // Found a match
-            if (var->index == lhs->index)
-            {
-                return true;
-            }
+    return true;
+}
 
-            // We're going to bind lhs to var, so var's level moves up to lhs's
-            var->level = std::min(level, var->level);
+static bool lowerLevel(std::vector<Arrow*>& queue, Type* type, int level)
+{
+    switch (type->tag())
+    {
+        case kArrow:
+            return lowerLevel(queue, static_cast<Arrow*>(type), level);
 
-            return false;
+        case kVar:
+        {
+            Var* var = static_cast<Var*>(type);
+            if (!var->isGeneric())
+            {
+                var->level = std::min(level, var->level);
+            }
+            break;
         }
 
         default:
-            assert(false);
+            break;
     }
+
+    return true;
 }
 
-void bind(Var* lhs, Type* rhs)
+bool bind(TypeArena& arena, Var* lhs, Type* rhs)
 {
     rhs = rhs->root();
     assert(!lhs->link && !lhs->isGeneric());
 
-    // If the variable lhs appeared in the rhs, then the assignment would yield
-    // an infinite, recursive type
-    if (occurs(lhs, lhs->level, rhs))
+    // Two distinct unbound variables can always be unified: link the lower
+    // ranked one to the other, which takes on the outermost level of the two
+    if (rhs->tag() == kVar && !static_cast<Var*>(rhs)->isGeneric())
+    {
+        Var* var = static_cast<Var*>(rhs);
+        assert(var != lhs);
+
+        int level = std::min(lhs->level, var->level);
+        if (lhs->rank > var->rank)
+        {
+            std::swap(lhs, var);
+        }
+        else if (lhs->rank == var->rank)
+        {
+            ++var->rank;
+        }
+
+        lhs->link = var;
+        var->level = level;
+
+        return true;
+    }
+
+    // The variables in rhs now move up to the level of lhs, and if lhs
+    // appeared in rhs, then the assignment would yield an infinite, recursive
+    // type. Searching rhs for both on every binding is quadratic in long chains
+    // of lets, so both are deferred.
+    if (rhs->tag() == kArrow && !isGround(rhs))
     {
-        throw std::runtime_error("infinite type");
+        Arrow* arrow = static_cast<Arrow*>(rhs);
+        if (!lowerLevel(arena._pendingLevels, arrow, lhs->level))
+        {
+            // Reported by the next cycle check, as the infinite types which
+            // are not caught early are
+            arena._unchecked.push_back({nullptr, arena._origin});
+            return false;
+        }
+
+        arena._unchecked.push_back({arrow, arena._origin});
     }
 
     lhs->link = rhs;
+    return true;
 }
 
-Type* generalize(Type* type, int level)
+bool adjustLevels(TypeArena& arena, int level)
 {
-    type = type->root();
+    std::vector<Arrow*> queue;
+    queue.swap(arena._pendingLevels);
 
-    switch (type->tag())
+    // Arrows being adjusted, and their next component
+    struct Frame
     {
-        // Type constants contain no variables
-        case kConstant:
-            return type;
+        Arrow* arrow;
+        size_t next;
+    };
 
-        // Generalize recursively for arrow types
-        case kArrow:
-        {
-            Arrow* arrow = dynamic_cast<Arrow*>(type);
+    WorkStack<Frame> stack;
 
-            Type* output = generalize(arrow->output, level);
+    // Arrows which cannot contain variables above the given level are left
+    // queued, since generalization will not search them anyway. Returns false
+    // on meeting an arrow within itself.
+    auto visit = [&](Arrow* arrow) {
+        if (arrow->pendingLevel == arrow->level)
+        {
+            return true;
+        }
 
-            std::vector<Type*> inputs;
-            for (auto* input : arrow->inputs)
+        if (arrow->level <= level)
+        {
+            if (!arrow->queued)
             {
-                inputs.push_back(generalize(input, level));
+                arrow->queued = true;
+                arena._pendingLevels.push_back(arrow);
             }
+            return true;
+        }
 
-            return new Arrow(inputs, output);
+        if (arrow->marked)
+        {
+            return false;
         }
 
-        case kVar:
+        HM_COUNT(levelAdjustments, 1);
+        arrow->marked = true;
+        stack.push({arrow, 0});
+        return true;
+    };
+
+    // The arrows not yet adjusted stay queued
+    auto fail = [&](size_t next) {
+        for (size_t i = 0; i < stack.size(); ++i)
         {
-            Var* var = dynamic_cast<Var*>(type);
-            assert(!var->link);
+            stack[i].arrow->marked = false;
+        }
 
-            // Generic type variables are unchanged
-            if (var->isGeneric())
+        for (size_t i = next; i < queue.size(); ++i)
+        {
+            arena._pendingLevels.push_back(queue[i]);
+        }
+
+        return false;
+    };
+
+    for (size_t i = 0; i < queue.size(); ++i)
+    {
+        Arrow* pending = queue[i];
+        pending->queued = false;
+        if (!visit(pending))
+        {
+            return fail(i + 1);
+        }
+
+        while (!stack.empty())
+        {
+            Frame& frame = stack.top();
+            Arrow* arrow = frame.arrow;
+
+            if (frame.next > arrow->inputs.size())
             {
-                return var;
+                stack.pop();
+                arrow->marked = false;
+                arrow->level = arrow->pendingLevel;
+                continue;
             }
 
-            // Unbound variables are generalized only if they are from a deeper level
-            if (var->level > level)
+            Type* component = (frame.next == 0) ? arrow->output : arrow->inputs[frame.next - 1];
+            ++frame.next;
+
+            // Pass the level down to the component, adjusting inner arrows in turn
+            component = component->root();
+            if (component->tag() == kArrow && !isGround(component))
             {
-                return Var::makeGeneric(var->index);
+                Arrow* inner = static_cast<Arrow*>(component);
+                inner->pendingLevel = std::min(inner->pendingLevel, arrow->pendingLevel);
+                if (!visit(inner))
+                {
+                    return fail(i + 1);
+                }
             }
             else
             {
-                return var;
+                lowerLevel(arena._pendingLevels, component, arrow->pendingLevel);
             }
         }
-
-        default:
-            assert(false);
     }
+
+    return true;
 }
 
-Type* instantiate(Type* type, int level, std::unordered_map<int, Type*>& replaced)
+bool checkCycles(TypeArena& arena, const void** origin)
 {
-    type = type->root();
+    uint32_t check = ++arena._checks;
 
-    switch (type->tag())
+    // Arrows being searched, and their next component
+    struct Frame
     {
-        // Type constants contain no variables
-        case kConstant:
-            return type;
+        Arrow* arrow;
+        size_t next;
+    };
 
-        // Generalize recursively for arrow types
-        case kArrow:
+    WorkStack<Frame> stack;
+
+    // Each arrow is searched at most once per check, however often it is
+    // shared. Returns false on meeting an arrow within itself.
+    auto visit = [&](Type* type) {
+        // An infinite type which unify caught before making it
+        if (!type)
         {
-            Arrow* arrow = dynamic_cast<Arrow*>(type);
+            return false;
+        }
 
-            Type* output = instantiate(arrow->output, level, replaced);
+        HM_COUNT(occursNodes, 1);
+        type = type->root();
 
-            std::vector<Type*> inputs;
-            for (auto* input : arrow->inputs)
-            {
-                inputs.push_back(instantiate(input, level, replaced));
-            }
+        if (type->tag() != kArrow || isGround(type))
+        {
+            return true;
+        }
 
-            return new Arrow(inputs, output);
+        Arrow* arrow = static_cast<Arrow*>(type);
+        if (arrow->checked == check)
+        {
+            return true;
         }
 
-        case kVar:
+        if (arrow->marked)
         {
-            Var* var = dynamic_cast<Var*>(type);
-            assert(!var->link);
+            return false;
+        }
+
+        arrow->marked = true;
+        stack.push({arrow, 0});
+        return true;
+    };
+
+    bool acyclic = true;
+    for (size_t i = 0; i < arena._unchecked.size() && acyclic; ++i)
+    {
+        acyclic = visit(arena._unchecked[i].arrow);
 
-            // Replace linked variables with their value and continue instantiation
-            if (var->link)
+        while (!stack.empty() && acyclic)
+        {
+            Frame& frame = stack.top();
+            Arrow* arrow = frame.arrow;
+
+            if (frame.next > arrow->inputs.size())
             {
-                return instantiate(var->link, level, replaced);
+                stack.pop();
+                arrow->marked = false;
+                arrow->checked = check;
+                continue;
             }
 
-            // Unbound variables are unchanged
-            if (!var->isGeneric())
+            Type* component = (frame.next == 0) ? arrow->output : arrow->inputs[frame.next - 1];
+            ++frame.next;
+
+            acyclic = visit(component);
+        }
+
+        // The binding searched first which leads to the cycle is taken to
+        // have made it
+        if (!acyclic && origin)
+        {
+            *origin = arena._unchecked[i].origin;
+        }
+    }
+
+    for (size_t i = 0; i < stack.size(); ++i)
+    {
+        stack[i].arrow->marked = false;
+    }
+
+    arena._unchecked.clear();
+    return acyclic;
+}
+
+// Rebuilds a type bottom-up, replacing each type variable var with mapVar(var).
+// Arrows for which keep(arrow) holds are known to be unaffected and are not
+// searched. Arrows are only copied when one of their components actually
+// changes, so unchanged subtrees are shared instead of copied. Once an arrow
+// has been searched, done(arrow, changed) is called.
+//
+// Components are visited output first, then inputs from left to right.
+template <typename MapVar, typename Keep, typename Done>
+Type* mapType(TypeArena& arena, Type* type, MapVar mapVar, Keep keep, Done done)
+{
+    // An arrow being rebuilt: its next component to visit, and the position
+    // of its first mapped component on the results stack
+    struct Frame
+    {
+        Arrow* arrow;
+        size_t next;
+        size_t base;
+    };
+
+    WorkStack<Frame> frames;
+    WorkStack<Type*> results;
+
+    auto visit = [&](Type* type) {
+        type = type->root();
+
+        if (isGround(type))
+        {
+            results.push(type);
+        }
+        else if (type->tag() == kArrow)
+        {
+            Arrow* arrow = static_cast<Arrow*>(type);
+            if (keep(arrow))
             {
-                return var;
+                results.push(arrow);
             }
-
-            // Generic variables are replaced with fresh unbound ones
-            auto i = replaced.find(var->index);
-            if (i == replaced.end())
+            else
             {
-                i = replaced.emplace(var->index, Var::makeUnbound(level)).first;
+                frames.push({arrow, 0, results.size()});
             }
+        }
+        else
+        {
+            Var* var = static_cast<Var*>(type);
+            assert(!var->link);
+            results.push(mapVar(var));
+        }
+    };
 
-            return i->second;
+    visit(type);
+    while (!frames.empty())
+    {
+        Frame& frame = frames.top();
+        Arrow* arrow = frame.arrow;
+        size_t arity = arrow->inputs.size();
+
+        if (frame.next <= arity)
+        {
+            Type* component = (frame.next == 0) ? arrow->output : arrow->inputs[frame.next - 1];
+            ++frame.next;
+
+            visit(component);
+            continue;
         }
 
-        default:
-            assert(false);
+        // All components are done: the mapped output is followed by the mapped inputs
+        size_t base = frame.base;
+        frames.pop();
+
+        Type** mapped = results.data() + base;
+        bool changed = (mapped[0] != arrow->output->root());
+        for (size_t i = 0; i < arity && !changed; ++i)
+        {
+            changed = (mapped[i + 1] != arrow->inputs[i]->root());
+        }
+        done(arrow, changed);
+
+        Type* result = arrow;
+        if (changed)
+        {
+            Span<Type*> inputs = arena.makeInputs(arity);
+            std::copy(mapped + 1, mapped + 1 + arity, inputs.begin());
+            result = arena.makeArrow(inputs, mapped[0]);
+        }
+
+        results.truncate(base);
+        results.push(result);
     }
+
+    return results[0];
 }
 
-Type* instantiate(Type* type, int level)
+namespace
+{
+
+// Unbound variables are numbered per arena and generic ones per scheme, so a
+// generic variable may share its index with an unbound one: tell them apart
+// by sign
+int64_t varKey(const Var* var)
 {
-    std::unordered_map<int, Type*> replaced;
-    return instantiate(type, level, replaced);
+    return var->isGeneric() ? -1 - var->index : var->index;
 }
 
-Type* unify(Type* lhs, Type* rhs)
+// Numbers variables in order of first occurrence. There are usually only a
+// handful, so they are searched linearly until there are too many.
+class VarNumbering
 {
-    lhs = lhs->root();
-    rhs = rhs->root();
+public:
+    uint32_t number(Var* var)
+    {
+        int64_t key = varKey(var);
+        if (_numbers.empty())
+        {
+            for (size_t i = 0; i < _indices.size(); ++i)
+            {
+                if (_indices[i] == key)
+                {
+                    return i;
+                }
+            }
+
+            if (_indices.size() < kLinear)
+            {
+                _indices.push(key);
+                return _indices.size() - 1;
+            }
+
+            for (size_t i = 0; i < _indices.size(); ++i)
+            {
+                _numbers.emplace(_indices[i], i);
+            }
+        }
+
+        return _numbers.emplace(key, _numbers.size()).first->second;
+    }
+
+    // Number of distinct variables numbered so far
+    uint32_t size() const
+    {
+        return _numbers.empty() ? _indices.size() : _numbers.size();
+    }
+
+private:
+    static constexpr size_t kLinear = 16;
+
+    WorkStack<int64_t, kLinear> _indices;
+    std::unordered_map<int64_t, uint32_t> _numbers;
+};
+
+} // namespace
 
-    // Type constants: name must be equal
-    if (lhs->tag() == kConstant && rhs->tag() == kConstant)
+TypeScheme generalize(TypeArena& arena, Type* type, int level)
+{
+    // Types may still be cyclic until checkCycles, so arrows being searched
+    // are marked, and meeting one of them again within itself is an error
+    if (!adjustLevels(arena, level))
     {
-        Constant* lhsConst = dynamic_cast<Constant*>(lhs);
-        Constant* rhsConst = dynamic_cast<Constant*>(rhs);
+        return {nullptr, 0};
+    }
+
+    // Generalized variables are numbered in order of first occurrence, and
+    // each is replaced by a single generic variable
+    VarNumbering numbering;
+    WorkStack<Type*, 16> generics;
+
+    auto mapVar = [&](Var* var) -> Type* {
+        assert(!var->isGeneric());
+
+        // Unbound variables are generalized only if they are from a deeper level
+        if (var->level <= level)
+        {
+            return var;
+        }
+
+        uint32_t number = numbering.number(var);
+        if (number == generics.size())
+        {
+            generics.push(arena.makeGeneric(number));
+        }
+
+        return generics[number];
+    };
+
+    // Skip arrows in which no variable is from a deeper level. An arrow met
+    // again within itself is skipped too, and the result discarded.
+    bool infinite = false;
+    auto keep = [&](Arrow* arrow) {
+        if (arrow->level <= level)
+        {
+            return true;
+        }
+
+        if (arrow->marked)
+        {
+            infinite = true;
+            return true;
+        }
+
+        arrow->marked = true;
+        return false;
+    };
 
-        if (lhsConst->name != rhsConst->name)
+    // An arrow which is unchanged has no variable from a deeper level, so it
+    // can be skipped from now on
+    auto done = [&](Arrow* arrow, bool changed) {
+        arrow->marked = false;
+
+        if (!changed && !infinite)
         {
-            return nullptr;
+            arrow->level = std::min(arrow->level, level);
+            arrow->pendingLevel = std::min(arrow->pendingLevel, level);
         }
+    };
 
-        return lhs;
+    Type* generalized = mapType(arena, type, mapVar, keep, done);
+    if (infinite)
+    {
+        return {nullptr, 0};
     }
-    // Arrow types: must unify recursively
-    else if (lhs->tag() == kArrow && rhs->tag() == kArrow)
+
+    return {generalized, numbering.size()};
+}
+
+Type* instantiate(TypeArena& arena, TypeScheme scheme, int level)
+{
+    if (scheme.quantifiers == 0)
     {
-        Arrow* lhsArrow = dynamic_cast<Arrow*>(lhs);
-        Arrow* rhsArrow = dynamic_cast<Arrow*>(rhs);
+        return scheme.type;
+    }
 
-        Type* output = unify(lhsArrow->output, rhsArrow->output);
+    // Fresh unbound variables, by number, created when first needed
+    WorkStack<Type*, 16> fresh;
+    for (uint32_t i = 0; i < scheme.quantifiers; ++i)
+    {
+        fresh.push(nullptr);
+    }
 
-        if (!output || lhsArrow->inputs.size() != rhsArrow->inputs.size())
+    auto mapVar = [&](Var* var) -> Type* {
+        // Unbound variables are unchanged
+        if (!var->isGeneric())
         {
-            return nullptr;
+            return var;
         }
 
-        std::vector<Type*> inputs;
-        for (size_t i = 0; i < lhsArrow->inputs.size(); ++i)
+        // Generic variables are replaced with fresh unbound ones
+        assert(var->index >= 0 && var->index < scheme.quantifiers);
+        Type*& replacement = fresh[var->index];
+        if (!replacement)
         {
-            Type* input = unify(lhsArrow->inputs[i], rhsArrow->inputs[i]);
-            if (!input)
+            replacement = arena.makeUnbound(level);
+        }
+
+        return replacement;
+    };
+
+    // Skip arrows with nothing to replace
+    auto keep = [](Arrow* arrow) { return !arrow->generic; };
+    auto done = [](Arrow*, bool) {};
+
+    return mapType(arena, scheme.type, mapVar, keep, done);
+}
+
+bool unify(TypeArena& arena, Type* lhs, Type* rhs)
+{
+    // Pairs of arrows being unified: the next pair of components to unify
+    // (output first, then the inputs), how deeply they are nested, and the
+    // level which both must end up at
+    struct Frame
+    {
+        Arrow* lhs;
+        Arrow* rhs;
+        size_t next;
+        uint64_t depth;
+        int level;
+    };
+
+    WorkStack<Frame> stack;
+
+    // Arrows being unified are marked, so that binding a variable inside one
+    // of them to it is caught (see lowerLevel). Ground arrows contain no
+    // variables and are never marked, nor given levels.
+    auto mark = [](Arrow* arrow, bool marked) {
+        if (!arrow->ground) arrow->marked = marked;
+    };
+    auto levelOf = [](Arrow* arrow) {
+        return arrow->ground ? std::numeric_limits<int>::max() : arrow->pendingLevel;
+    };
+
+    // Infinite types caught here are left for the next cycle check to report
+    auto infinite = [&]() {
+        arena._unchecked.push_back({nullptr, arena._origin});
+        return false;
+    };
+
+    // Unifies the roots of a single pair of types, deferring the components of
+    // arrows to the stack. Returns false if they cannot be unified.
+    auto step = [&](Type* left, Type* right, uint64_t depth) {
+        HM_COUNT(unifyCalls, 1);
+        HM_MAX(unifyMaxDepth, depth);
+
+        left = left->root();
+        right = right->root();
+
+        // Identical types (including identical type variables) trivially unify
+        if (left == right)
+        {
+            return true;
+        }
+
+        // Ground types are interned (this covers all pairs of type constants),
+        // so distinct objects are distinct types
+        if (isGround(left) && isGround(right))
+        {
+            return false;
+        }
+
+        // Arrow types: components must unify
+        if (left->tag() == kArrow && right->tag() == kArrow)
+        {
+            Arrow* leftArrow = static_cast<Arrow*>(left);
+            Arrow* rightArrow = static_cast<Arrow*>(right);
+
+            if (leftArrow->inputs.size() != rightArrow->inputs.size())
             {
-                return nullptr;
+                return false;
             }
 
-            inputs.push_back(input);
-        }
+            // Meeting an arrow again within itself: the type is infinite
+            if (leftArrow->marked || rightArrow->marked)
+            {
+                return infinite();
+            }
 
-        return new Arrow(inputs, output);
-    }
+            int level = std::min(levelOf(leftArrow), levelOf(rightArrow));
+            mark(leftArrow, true);
+            mark(rightArrow, true);
 
-    if (lhs->tag() == kVar)
-    {
-        Var* lhsVar = dynamic_cast<Var*>(lhs);
-        assert(!lhsVar->link);
+            stack.push({leftArrow, rightArrow, 0, depth, level});
+            return true;
+        }
 
         // Unifying an unbound variable binds the variable to the other type
-        if (!lhsVar->isGeneric())
+        if (left->tag() == kVar && !static_cast<Var*>(left)->isGeneric())
+        {
+            return bind(arena, static_cast<Var*>(left), right);
+        }
+
+        if (right->tag() == kVar && !static_cast<Var*>(right)->isGeneric())
+        {
+            return bind(arena, static_cast<Var*>(right), left);
+        }
+
+        return false;
+    };
+
+    auto unmarkAll = [&]() {
+        for (size_t i = 0; i < stack.size(); ++i)
         {
-            bind(lhsVar, rhs);
-            return rhs;
+            mark(stack[i].lhs, false);
+            mark(stack[i].rhs, false);
         }
+    };
+
+    if (!step(lhs, rhs, 1))
+    {
+        return false;
     }
 
-    if (rhs->tag() == kVar)
+    while (!stack.empty())
     {
-        Var* rhsVar = dynamic_cast<Var*>(rhs);
-        assert(!rhsVar->link);
+        Frame& frame = stack.top();
 
-        // Unifying an unbound variable binds the variable to the other type
-        if (!rhsVar->isGeneric())
+        // Both arrows are now the same type, so they share a level
+        if (frame.next > frame.lhs->inputs.size())
+        {
+            Frame done = stack.pop();
+            mark(done.lhs, false);
+            mark(done.rhs, false);
+            lowerLevel(arena._pendingLevels, done.lhs, done.level);
+            lowerLevel(arena._pendingLevels, done.rhs, done.level);
+            continue;
+        }
+
+        // Copied out, since step may push onto the stack and move frame
+        size_t i = frame.next++;
+        Type* left = i == 0 ? frame.lhs->output : frame.lhs->inputs[i - 1];
+        Type* right = i == 0 ? frame.rhs->output : frame.rhs->inputs[i - 1];
+        uint64_t depth = frame.depth + 1;
+
+        // Both components must end up at the level of the pair. Those on
+        // the left are lowered (unless they are already low enough), and
+        // unifying brings those on the right down with them. A component
+        // which is itself being unified makes the type infinite.
+        bool unified = frame.lhs->level <= frame.level ||
+                       lowerLevel(arena._pendingLevels, left->root(), frame.level) ||
+                       infinite();
+
+        if (!unified || !step(left, right, depth))
         {
-            bind(rhsVar, lhs);
-            return lhs;
+            unmarkAll();
+            return false;
         }
     }
 
-    return nullptr;
+    return true;
 }
 
-void print(std::ostream& out, Type* type, std::unordered_map<int, char>& varNames)
+Type* copy(TypeArena& arena, Type* type)
 {
-    type = type->root();
+    // Closed types may share subtrees, which are copied only once
+    std::unordered_map<Type*, Type*> copies;
 
-    switch (type->tag())
+    // An arrow being copied: its next component to visit, and the position of
+    // its first copied component on the results stack
+    struct Frame
     {
-        case kConstant:
-        {
-            Constant* constant = dynamic_cast<Constant*>(type);
-            out << constant->name;
+        Arrow* arrow;
+        size_t next;
+        size_t base;
+    };
 
-            break;
+    WorkStack<Frame> frames;
+    WorkStack<Type*> results;
+
+    auto visit = [&](Type* type) {
+        type = type->root();
+
+        auto i = copies.find(type);
+        if (i != copies.end())
+        {
+            results.push(i->second);
+            return;
         }
 
-        // Search recursively for arrow types
-        case kArrow:
+        switch (type->tag())
         {
-            Arrow* arrow = dynamic_cast<Arrow*>(type);
+            case kConstant:
+            {
+                Type* result = arena.makeConstant(static_cast<Constant*>(type)->name);
+                copies.emplace(type, result);
+                results.push(result);
+                break;
+            }
 
-            bool brackets = (arrow->inputs.size() != 1) || arrow->inputs[0]->root()->tag() == kArrow;
-            if (brackets) out << "|";
-            for (size_t i = 0; i < arrow->inputs.size(); ++i)
+            case kArrow:
+                frames.push({static_cast<Arrow*>(type), 0, results.size()});
+                break;
+
+            // Generic variables are identified by their index, which is kept
+            case kVar:
             {
-                if (i != 0) out << ", ";
-                print(out, arrow->inputs[i], varNames);
+                Var* var = static_cast<Var*>(type);
+                if (!var->isGeneric())
+                {
+                    throw std::runtime_error("type has unbound variables");
+                }
+
+                Type* result = arena.makeGeneric(var->index);
+                copies.emplace(type, result);
+                results.push(result);
+                break;
             }
-            if (brackets) out << "|";
 
-            out << " -> ";
+            default:
+                assert(false);
+        }
+    };
+
+    visit(type);
+    while (!frames.empty())
+    {
+        Frame& frame = frames.top();
+        Arrow* arrow = frame.arrow;
+        size_t arity = arrow->inputs.size();
 
-            bool parens = arrow->output->root()->tag() == kArrow;
-            if (parens) out << "(";
-            print(out, arrow->output, varNames);
-            if (parens) out << ")";
+        if (frame.next <= arity)
+        {
+            Type* component = (frame.next == 0) ? arrow->output : arrow->inputs[frame.next - 1];
+            ++frame.next;
 
-            break;
+            visit(component);
+            continue;
         }
 
-        case kVar:
+        // All components are done: the copied output is followed by the copied inputs
+        size_t base = frame.base;
+        frames.pop();
+
+        Type** copied = results.data() + base;
+        Span<Type*> inputs = arena.makeInputs(arity);
+        std::copy(copied + 1, copied + 1 + arity, inputs.begin());
+        Type* result = arena.makeArrow(inputs, copied[0]);
+
+        copies.emplace(arrow, result);
+        results.truncate(base);
+        results.push(result);
+    }
+
+    return results[0];
+}
+
+
+// Both walk types in the order in which they are printed: the inputs of an
+// arrow from left to right, then its output
+
+uint64_t hashType(Type* type)
+{
+    VarNumbering vars;
+    WorkStack<Type*> stack;
+    stack.push(type);
+
+    // Each node contributes its tag, together with its name, arity or number
+    uint64_t hash = 0;
+    while (!stack.empty())
+    {
+        type = stack.pop()->root();
+
+        switch (type->tag())
         {
-            Var* var = dynamic_cast<Var*>(type);
-            assert(!var->link);
+            case kConstant:
+                hash = mix(hash, hashName(static_cast<Constant*>(type)->name) * 4 + kConstant);
+                break;
 
-            // Refer to type variables by sequential lowercase characters as encountered
-            auto i = varNames.find(var->index);
-            if (i == varNames.end())
+            case kArrow:
             {
-                i = varNames.emplace(var->index, char('a' + varNames.size())).first;
+                Arrow* arrow = static_cast<Arrow*>(type);
+                hash = mix(hash, arrow->inputs.size() * 4 + kArrow);
+
+                stack.push(arrow->output);
+                for (size_t i = arrow->inputs.size(); i > 0; --i)
+                {
+                    stack.push(arrow->inputs[i - 1]);
+                }
+                break;
             }
 
-            out << i->second;
+            case kVar:
+                hash = mix(hash, uint64_t(vars.number(static_cast<Var*>(type))) * 4 + kVar);
+                break;
+        }
+    }
 
-            break;
+    return hash;
+}
+
+bool alphaEquivalent(Type* lhs, Type* rhs)
+{
+    // Variables correspond if they first occur at the same point in both
+    VarNumbering lhsVars;
+    VarNumbering rhsVars;
+
+    struct Pair
+    {
+        Type* lhs;
+        Type* rhs;
+    };
+
+    WorkStack<Pair> stack;
+    stack.push({lhs, rhs});
+
+    while (!stack.empty())
+    {
+        Pair pair = stack.pop();
+        Type* left = pair.lhs->root();
+        Type* right = pair.rhs->root();
+
+        // Ground types from the same arena are interned. Other identical
+        // types are still searched, since they number their variables.
+        if (left == right && isGround(left))
+        {
+            continue;
         }
 
-        default:
-            assert(false);
+        if (left->tag() != right->tag())
+        {
+            return false;
+        }
+
+        switch (left->tag())
+        {
+            case kConstant:
+                if (static_cast<Constant*>(left)->name != static_cast<Constant*>(right)->name)
+                {
+                    return false;
+                }
+                break;
+
+            case kArrow:
+            {
+                Arrow* leftArrow = static_cast<Arrow*>(left);
+                Arrow* rightArrow = static_cast<Arrow*>(right);
+
+                size_t arity = leftArrow->inputs.size();
+                if (rightArrow->inputs.size() != arity)
+                {
+                    return false;
+                }
+
+                stack.push({leftArrow->output, rightArrow->output});
+                for (size_t i = arity; i > 0; --i)
+                {
+                    stack.push({leftArrow->inputs[i - 1], rightArrow->inputs[i - 1]});
+                }
+                break;
+            }
+
+            case kVar:
+                if (lhsVars.number(static_cast<Var*>(left)) != rhsVars.number(static_cast<Var*>(right)))
+                {
+                    return false;
+                }
+                break;
+        }
     }
+
+    return true;
 }
 
 std::ostream& operator<<(std::ostream& out, Type* type)
 {
-    std::unordered_map<int, char> varNames;
-    print(out, type, varNames);
+    // Refer to type variables by sequential lowercase characters as encountered
+    std::unordered_map<int64_t, char> varNames;
+
+    // Output still to be written: either a type or a piece of punctuation
+    struct Item
+    {
+        Type* type;
+        const char* text;
+    };
+
+    WorkStack<Item> stack;
+    stack.push({type, nullptr});
+
+    while (!stack.empty())
+    {
+        Item item = stack.pop();
+        if (item.text)
+        {
+            out << item.text;
+            continue;
+        }
+
+        Type* type = item.type->root();
+        switch (type->tag())
+        {
+            case kConstant:
+                out << static_cast<Constant*>(type)->name;
+                break;
+
+            // Pieces of arrow types are pushed in reverse order of output
+            case kArrow:
+            {
+                Arrow* arrow = static_cast<Arrow*>(type);
+
+                bool parens = arrow->output->root()->tag() == kArrow;
+                if (parens) stack.push({nullptr, ")"});
+                stack.push({arrow->output, nullptr});
+                if (parens) stack.push({nullptr, "("});
+
+                stack.push({nullptr, " -> "});
+
+                bool brackets = (arrow->inputs.size() != 1) || arrow->inputs[0]->root()->tag() == kArrow;
+                if (brackets) stack.push({nullptr, "|"});
+                for (size_t i = arrow->inputs.size(); i > 0; --i)
+                {
+                    stack.push({arrow->inputs[i - 1], nullptr});
+                    if (i != 1) stack.push({nullptr, ", "});
+                }
+                if (brackets) stack.push({nullptr, "|"});
+
+                break;
+            }
+
+            case kVar:
+            {
+                Var* var = static_cast<Var*>(type);
+                assert(!var->link);
+
+                auto i = varNames.find(varKey(var));
+                if (i == varNames.end())
+                {
+                    i = varNames.emplace(varKey(var), char('a' + varNames.size())).first;
+                }
+
+                out << i->second;
+
+                break;
+            }
+
+            default:
+                assert(false);
+        }
+    }
+
     return out;
 }
 
 Type* Var::root()
 {
+    HM_COUNT(rootCalls, 1);
+
     if (!link)
         return this;
 
-    // Find the root of the chain
-    Var* t = this;
-    while (t->link)
+    // A single pass with path halving: each variable visited on the way is
+    // relinked to its grandparent, so repeated calls keep shortening the chain
+    Var* var = this;
+    uint64_t length = 0;
+    Type* root = nullptr;
+
+    while (!root)
     {
-        if (t->link->tag() == kVar)
+        Type* parent = var->link;
+        ++length;
+
+        if (parent->tag() != kVar || !static_cast<Var*>(parent)->link)
         {
-            t = dynamic_cast<Var*>(t->link);
+            root = parent;
+            break;
+        }
+
+        Type* grandparent = static_cast<Var*>(parent)->link;
+        ++length;
+
+        HM_COUNT(rootCompressions, 1);
+        var->link = grandparent;
+
+        if (grandparent->tag() != kVar || !static_cast<Var*>(grandparent)->link)
+        {
+            root = grandparent;
         }
         else
         {
-            break;
+            var = static_cast<Var*>(grandparent);
         }
     }
 
-    Type* root = t->link ? t->link : t;
+    HM_COUNT(rootLinks, length);
+    HM_MAX(rootMaxChain, length);
+
+    return root;
+}
 
-    // Path compression: point every link in the chain directly to the root
-    // (improves time complexity of some algorithms)
-    t = this;
-    while (t->link)
+Constant* TypeArena::makeConstant(std::string_view name)
+{
+    if (_base)
     {
-        if (t->link->tag() == kVar)
+        auto i = _base->_constants.find(name);
+        if (i != _base->_constants.end())
         {
-            Var* next = dynamic_cast<Var*>(t->link);
-            t->link = root;
-            t = next;
+            return i->second;
         }
-        else
+    }
+
+    auto i = _constants.find(name);
+    if (i != _constants.end())
+    {
+        return i->second;
+    }
+
+    // Copy the name, so that it lives exactly as long as the type
+    Span<char> chars = _arena.makeArray<char>(name.size());
+    std::copy(name.begin(), name.end(), chars.begin());
+
+    Constant* constant = _arena.make<Constant>(std::string_view(chars.data(), chars.size()));
+    _constants.emplace(constant->name, constant);
+    HM_COUNT(constants, 1);
+
+    return constant;
+}
+
+Arrow* TypeArena::makeArrow(Span<Type*> inputs, Type* output)
+{
+    // Only arrows built entirely from ground types are interned. Components
+    // are replaced by their roots so that they can be compared by identity.
+    output = output->root();
+    bool ground = isGround(output);
+
+    for (auto& input : inputs)
+    {
+        input = input->root();
+        ground = ground && isGround(input);
+    }
+
+    if (!ground)
+    {
+        Arrow* arrow = _arena.make<Arrow>(inputs, output);
+        HM_COUNT(arrows, 1);
+
+        auto summarize = [&](Type* component) {
+            if (component->tag() == kArrow)
+            {
+                Arrow* inner = static_cast<Arrow*>(component);
+                arrow->generic = arrow->generic || inner->generic;
+                arrow->level = std::max(arrow->level, inner->level);
+            }
+            else if (component->tag() == kVar)
+            {
+                Var* var = static_cast<Var*>(component);
+                if (var->isGeneric())
+                {
+                    arrow->generic = true;
+                }
+                else
+                {
+                    arrow->level = std::max(arrow->level, var->level);
+                }
+            }
+        };
+
+        summarize(output);
+        for (auto* input : inputs)
         {
-            break;
+            summarize(input);
+        }
+        arrow->pendingLevel = arrow->level;
+
+        return arrow;
+    }
+
+    if (_base)
+    {
+        auto i = _base->_arrows.find(ArrowKey{inputs, output});
+        if (i != _base->_arrows.end())
+        {
+            return i->second;
         }
     }
 
-    return root;
+    auto i = _arrows.find(ArrowKey{inputs, output});
+    if (i != _arrows.end())
+    {
+        return i->second;
+    }
+
+    Arrow* arrow = _arena.make<Arrow>(inputs, output);
+    arrow->ground = true;
+    HM_COUNT(arrows, 1);
+    _arrows.emplace(ArrowKey{inputs, output}, arrow);
+
+    return arrow;
+}
+
+Arrow* TypeArena::makeArrow(std::initializer_list<Type*> inputs, Type* output)
+{
+    return makeArrow(_arena.makeArray<Type*>(inputs), output);
+}
+
+Var* TypeArena::makeUnbound(int level)
+{
+    Var* var = new (_arena.allocate(sizeof(Var), alignof(Var))) Var;
+    var->level = level;
+    var->index = _nextIndex++;
+    HM_COUNT(vars, 1);
+    return var;
+}
+
+Var* TypeArena::makeGeneric(int64_t index)
+{
+    Var* var = new (_arena.allocate(sizeof(Var), alignof(Var))) Var;
+    var->level = -1;
+    var->index = index;
+    HM_COUNT(vars, 1);
+    return var;
+}
+
+void TypeArena::discardDeferred()
+{
+    for (Arrow* arrow : _pendingLevels)
+    {
+        arrow->queued = false;
+        arrow->pendingLevel = kNoLevel;
+    }
+
+    _pendingLevels.clear();
+    _unchecked.clear();
+}
+
+bool TypeArena::ArrowKey::operator==(const ArrowKey& other) const
+{
+    return output == other.output && std::equal(inputs.begin(), inputs.end(), other.inputs.begin(), other.inputs.end());
+}
+
+size_t TypeArena::ArrowKeyHash::operator()(const ArrowKey& key) const
+{
+    std::hash<Type*> hash;
+
+    size_t result = hash(key.output);
+    for (auto* input : key.inputs)
+    {
+        result = result * 31 + hash(input);
+    }
+
+    return result;
 }
 
 } // namespace typ
@@ -1,6 +1,11 @@
 #pragma once
+#include "arena.hpp"
+#include <cstdint>
+#include <initializer_list>
 #include <iostream>
+#include <limits>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 
@@ -8,6 +13,9 @@ namespace typ {
 
 enum Tag { kConstant, kArrow, kVar };
 
+// Level bound for types that contain no unbound type variables
+constexpr int kNoLevel = std::numeric_limits<int>::min();
+
 // Generic base class for all types
 class Type
 {
@@ -22,23 +30,77 @@ public:
 class Constant;
 class Arrow;
 class Var;
+class TypeArena;
 
 // Determines if the type variable lhs appears anywhere in the type rhs
 // Also adjusts the level of unbound type variables in rhs to prepare for binding lhs to rhs
+//
+// This is the eager form of the checks which bind defers.
 bool occurs(Var* lhs, int level, Type* rhs);
 
 // Assign a value to a type variable
-void bind(Var* lhs, Type* rhs);
+//
+// If rhs is also an unbound variable, then either one may end up linked to the
+// other: the one with the shorter chains is linked below the other (union by
+// rank), which keeps chains logarithmic even before path compression.
+//
+// Otherwise rhs is not searched. Lowering the levels of its variables to that
+// of lhs is deferred to adjustLevels, and the occurs check to checkCycles.
+// Returns false, binding nothing, if rhs is being unified with a type that
+// contains lhs (an infinite type, caught early, but still reported as one by
+// checkCycles).
+bool bind(TypeArena& arena, Var* lhs, Type* rhs);
+
+// Applies the level adjustments deferred by bind to the arrows which may
+// contain variables above the given level. The others remain deferred.
+// Returns false if it meets an infinite type.
+bool adjustLevels(TypeArena& arena, int level);
+
+// Returns false if a variable bound since the last check now occurs in its own
+// type, or if unify has since failed on an infinite type. Callers check this
+// before reporting a failed unification, so that it is reported as infinite,
+// as it would have been by an eager occurs check.
+//
+// If origin is given, it is set to the origin of the binding which leads to
+// the infinite type (see TypeArena::setOrigin).
+bool checkCycles(TypeArena& arena, const void** origin = nullptr);
+
+// A generalized type. Its generic variables are numbered densely from zero,
+// so that instantiating it substitutes them from an array, and a type without
+// any (a monomorphic type) is used as it is.
+struct TypeScheme
+{
+    Type* type;
+    uint32_t quantifiers;
+};
 
 // Replace all unbound type variables in type, with level > the given one with generic type vars
-Type* generalize(Type* type, int level);
+// Only arrows which may contain such variables are searched. The type must not
+// already contain generic variables. Returns a scheme with a null type if the
+// type is infinite.
+TypeScheme generalize(TypeArena& arena, Type* type, int level);
 
 // Replace all generic type variables with unbound variables with the given level
-Type* instantiate(Type* type, int level);
+// A monomorphic type is returned as it is, without being searched.
+Type* instantiate(TypeArena& arena, TypeScheme scheme, int level);
 
 // Find an assignment of type variables that makes lhs and rhs equal
-// Returns nullptr if none exists (variables may have already been assigned)
-Type* unify(Type* lhs, Type* rhs);
+// Returns false if none exists, or if it would make an infinite type
+// (variables may have already been assigned)
+bool unify(TypeArena& arena, Type* lhs, Type* rhs);
+
+// Copies a type with no unbound variables into another arena. Throws otherwise,
+// so it can be used on types which isClosed cannot vouch for.
+Type* copy(TypeArena& arena, Type* type);
+
+// Hash of the structure of a type, in which variables are identified only by
+// the order in which they first occur (as when printed). Types which differ
+// only by the naming of their variables hash alike, even from different arenas.
+uint64_t hashType(Type* type);
+
+// Are the types the same, up to a consistent renaming of their variables?
+// Generic and unbound variables are not distinguished, just as in printing.
+bool alphaEquivalent(Type* lhs, Type* rhs);
 
 std::ostream& operator<<(std::ostream& out, Type* type);
 
@@ -46,61 +108,191 @@ std::ostream& operator<<(std::ostream& out, Type* type);
 class Constant : public Type
 {
 public:
-    Constant(const std::string& name)
+    Constant(std::string_view name)
     : name(name)
     {}
 
     virtual Tag tag() const { return kConstant; }
 
-    std::string name;
+    std::string_view name;
 };
 
 // Function type: |Int, Bool| -> String
 class Arrow : public Type
 {
 public:
-    Arrow(const std::vector<Type*>& inputs, Type* output)
+    Arrow(Span<Type*> inputs, Type* output)
     : inputs(inputs), output(output)
     {}
 
     virtual Tag tag() const { return kArrow; }
 
-    std::vector<Type*> inputs;
+    Span<Type*> inputs;
     Type* output;
+
+    // Set for interned arrows built only from ground types
+    bool ground = false;
+
+    // Set while the arrow is queued for adjustLevels
+    bool queued = false;
+
+    // Set while the arrow is on the path of a traversal: meeting it again
+    // within itself means that a variable occurs in its own type
+    bool marked = false;
+
+    // Summary of the components when the arrow was built: whether it contains
+    // generic variables, and the highest level of any unbound variable in it.
+    // Levels only ever decrease, so the latter remains an upper bound.
+    bool generic = false;
+    int level = kNoLevel;
+
+    // Level which bind has requested for the variables in the arrow, but which
+    // adjustLevels has yet to pass down to them (pending while below level)
+    int pendingLevel = kNoLevel;
+
+    // The last cycle check which searched the arrow (see checkCycles)
+    uint32_t checked = 0;
 };
 
 // Type variable (may be generic or not; if not, may be linked / assigned to another type)
 class Var : public Type
 {
 public:
-    static Var* makeUnbound(int level)
-    {
-        Var* var = new Var;
-        var->level = level;
-        var->index = s_nextIndex++;
-        return var;
-    }
-
-    static Var* makeGeneric(int index)
-    {
-        Var* var = new Var;
-        var->level = -1;
-        var->index = index;
-        return var;
-    }
-
     virtual Type* root();
 
     Type* link = nullptr;
-    int index; // uniquely identifies this variable
+    int64_t index; // identifies an unbound variable within its TypeArena, or a generic one within its scheme
     int level; // only for unbound variables (-1 means generic)
 
+    // Only for unbound variables: an upper bound on the length of the longest
+    // chain of variables linked to this one (see bind)
+    uint32_t rank = 0;
+
     virtual Tag tag() const { return kVar; }
     bool isGeneric() const { return level == -1; }
 
 private:
+    friend class TypeArena;
+
     Var() {}
-    static int s_nextIndex;
+};
+
+// Does this (root) type contain no type variables at all? Ground types are
+// interned, so two ground types from the same arena are equal iff they are
+// the same object.
+inline bool isGround(Type* type)
+{
+    switch (type->tag())
+    {
+        case kConstant: return true;
+        case kArrow: return static_cast<Arrow*>(type)->ground;
+        default: return false;
+    }
+}
+
+// Does this type contain no unbound type variables? Nothing can change a closed
+// type, so it can outlive the analysis which built it (see TypeCache).
+//
+// Conservative for arrows: an arrow built with unbound variables is never
+// considered closed, even if they have since been bound.
+inline bool isClosed(Type* type)
+{
+    type = type->root();
+
+    switch (type->tag())
+    {
+        case kConstant: return true;
+        case kArrow: return static_cast<Arrow*>(type)->level == kNoLevel;
+        default: return static_cast<Var*>(type)->isGeneric();
+    }
+}
+
+// Owner for all types created during an analysis. Types are bump-allocated and
+// are all freed together when the arena is destroyed.
+//
+// Type variables are numbered per arena, so independent analyses share no
+// state (and can run on different threads), and produce the same numbering
+// every time they are run.
+//
+// Constants and ground arrows are hash-consed: requesting the same one twice
+// returns the same object (which may belong to a base arena).
+class TypeArena
+{
+public:
+    TypeArena() = default;
+
+    // Extends a frozen arena: its constants and ground arrows are returned
+    // rather than created again, so types from both compare by identity. The
+    // base must outlive this arena, and must no longer change.
+    explicit TypeArena(const TypeArena* base)
+    : _base(base)
+    {}
+
+    Constant* makeConstant(std::string_view name);
+
+    Arrow* makeArrow(Span<Type*> inputs, Type* output);
+    Arrow* makeArrow(std::initializer_list<Type*> inputs, Type* output);
+
+    // Uninitialized storage for the inputs of an arrow type
+    Span<Type*> makeInputs(size_t size) { return _arena.makeArray<Type*>(size); }
+
+    Var* makeUnbound(int level);
+    Var* makeGeneric(int64_t index);
+
+    const Arena& arena() const { return _arena; }
+
+    // Bindings are only searched for infinite types later, so each records the
+    // origin last set here (such as the node being checked), for checkCycles
+    // to tell where an infinite type was made
+    void setOrigin(const void* origin) { _origin = origin; }
+
+    // Drops the level adjustments and cycle checks deferred by bind, once the
+    // types they concern are abandoned (as those of a program which failed
+    // to check are)
+    void discardDeferred();
+
+private:
+    friend bool bind(TypeArena& arena, Var* lhs, Type* rhs);
+    friend bool adjustLevels(TypeArena& arena, int level);
+    friend bool checkCycles(TypeArena& arena, const void** origin);
+    friend bool unify(TypeArena& arena, Type* lhs, Type* rhs);
+
+    // Arrows are keyed by the identity of their (interned) components
+    struct ArrowKey
+    {
+        Span<Type*> inputs;
+        Type* output;
+
+        bool operator==(const ArrowKey& other) const;
+    };
+
+    struct ArrowKeyHash
+    {
+        size_t operator()(const ArrowKey& key) const;
+    };
+
+    Arena _arena;
+    int64_t _nextIndex = 0;
+
+    const TypeArena* _base = nullptr;
+
+    std::unordered_map<std::string_view, Constant*> _constants;
+    std::unordered_map<ArrowKey, Arrow*, ArrowKeyHash> _arrows;
+
+    // Arrows queued for level adjustment
+    std::vector<Arrow*> _pendingLevels;
+
+    // Arrows bound to variables since the last cycle check, and null for each
+    // infinite type which unify caught early
+    struct Unchecked
+    {
+        Arrow* arrow;
+        const void* origin;
+    };
+
+    std::vector<Unchecked> _unchecked;
+    const void* _origin = nullptr;
+    uint32_t _checks = 0;
 };
 
 } // namespace typ
@@ -0,0 +1,60 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <type_traits>
+
+// Explicit stack for iterative traversals, so that deeply nested inputs cannot
+// overflow the native stack. The first N entries are stored inline, so shallow
+// traversals never touch the heap.
+template <typename T, size_t N = 64>
+class WorkStack
+{
+    static_assert(std::is_trivially_copyable<T>::value, "entries are copied with memcpy semantics");
+
+public:
+    WorkStack() = default;
+
+    ~WorkStack()
+    {
+        if (_data != _inline) delete[] _data;
+    }
+
+    WorkStack(const WorkStack&) = delete;
+    WorkStack& operator=(const WorkStack&) = delete;
+
+    void push(const T& value)
+    {
+        if (_size == _capacity) grow();
+        _data[_size++] = value;
+    }
+
+    T pop() { return _data[--_size]; }
+    T& top() { return _data[_size - 1]; }
+
+    T& operator[](size_t i) { return _data[i]; }
+    T* data() { return _data; }
+
+    bool empty() const { return _size == 0; }
+    size_t size() const { return _size; }
+
+    // Discards everything above the given size
+    void truncate(size_t size) { _size = std::min(_size, size); }
+    void clear() { _size = 0; }
+
+private:
+    void grow()
+    {
+        T* data = new T[_capacity * 2];
+        std::copy(_data, _data + _size, data);
+
+        if (_data != _inline) delete[] _data;
+
+        _data = data;
+        _capacity *= 2;
+    }
+
+    T _inline[N];
+    T* _data = _inline;
+    size_t _size = 0;
+    size_t _capacity = N;
+};